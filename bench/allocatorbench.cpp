@@ -0,0 +1,418 @@
+// Standalone allocator microbenchmark, drives MemoryAllocator directly
+// without running the whole simulation.
+//
+// build (from repo root):
+//   g++ -std=c++17 -O2 -pthread -Isrc bench/allocatorbench.cpp src/memoryallocator.cpp
+//       src/freeblockindex.cpp src/ownershiprunmap.cpp src/unitjobarray.cpp src/operationhistogram.cpp
+//       src/binaryio.cpp src/csvwriter.cpp src/randomgenerator.cpp -o allocatorbench
+//
+// scenarios, each run for every algorithm and memory size:
+//   fill        allocate from empty until occupancy percent reached
+//   churn       after fill, free a random live block then malloc a new one
+//   fragmented  fill with small/large pairs, free the small ones, then churn
+//               requests too big for the holes (worst case for scanning)
+
+#include "memoryallocator.h"
+#include "csvwriter.h"
+#include "randomgenerator.h"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+
+struct BenchConfig
+{
+    unsigned seed;
+    int memoryUnitSize;
+    vector<long long> memoryUnitCounts;
+    int occupancyPercent; //fill target
+    int liveBlocks;       //about how many blocks are live once filled
+    int operations;       //timed ops for churn scenarios
+    int engineType;       // 0=scan 1=indexed
+    int ownershipType;    // 0=unitJobId in memory 1=run map 2=unitJobId mapped from out/bench_unitmap.bin
+    string outputPath;
+
+    BenchConfig()
+    {
+        seed = 125;
+        memoryUnitSize = 8;
+        memoryUnitCounts = {1000, 10000, 100000, 1000000};
+        occupancyPercent = 80;
+        liveBlocks = 500;
+        operations = 5000;
+        engineType = 0;
+        ownershipType = 0;
+        outputPath = "out/bench_allocators.csv";
+    }
+};
+
+
+struct BenchResult //one row of the output csv
+{
+    string scenario;
+    string algorithm;
+    long long memoryUnitCount;
+
+    long long mallocCount;
+    long long freeCount;
+    long long failedMallocs;
+    long long totalNanoseconds;
+
+    vector<long long> latencies; //ns per op, sorted before reading percentiles
+
+    long long allocationOperations; //allocationOperationCount delta
+    long long freeOperations;       //freeOperationCount delta
+
+    BenchResult()
+    {
+        memoryUnitCount = 0;
+        mallocCount = 0;
+        freeCount = 0;
+        failedMallocs = 0;
+        totalNanoseconds = 0;
+        allocationOperations = 0;
+        freeOperations = 0;
+    }
+
+    long long percentile(double p)
+    {
+        if (latencies.empty()) return 0;
+
+        size_t index = (size_t)(p * (double)(latencies.size() - 1) + 0.5);
+        return latencies[index];
+    }
+};
+
+
+long long nowNanoseconds()
+{
+    return (long long)chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+long long timedMalloc(MemoryAllocator &allocator, long long sizeBytes, BenchResult &result)
+{
+    long long start = nowNanoseconds();
+    long long location = allocator.mallocByType(sizeBytes);
+    long long elapsed = nowNanoseconds() - start;
+
+    result.latencies.push_back(elapsed);
+    result.totalNanoseconds += elapsed;
+    result.mallocCount++;
+    if (location < 0) result.failedMallocs++;
+
+    return location;
+}
+
+
+void timedFree(MemoryAllocator &allocator, long long location, BenchResult &result)
+{
+    long long start = nowNanoseconds();
+    allocator.freeFF(location);
+    long long elapsed = nowNanoseconds() - start;
+
+    result.latencies.push_back(elapsed);
+    result.totalNanoseconds += elapsed;
+    result.freeCount++;
+}
+
+
+// block size in bytes, uniform around the mean that gives liveBlocks at the occupancy target
+long long randomBlockBytes(const BenchConfig &config, long long memoryUnitCount, RandomGenerator &rng)
+{
+    long long meanUnits = (memoryUnitCount * config.occupancyPercent / 100) / config.liveBlocks;
+    if (meanUnits < 1) meanUnits = 1;
+    if (meanUnits > 1000000000) meanUnits = 1000000000; //rng works in int
+
+    int low = (int)(meanUnits / 2);
+    if (low < 1) low = 1;
+    int high = (int)(meanUnits + meanUnits / 2);
+
+    return (long long)rng.randomInclusive(low, high) * config.memoryUnitSize;
+}
+
+
+// malloc until occupancy target, returns live locations
+vector<long long> fillToOccupancy(MemoryAllocator &allocator, const BenchConfig &config, RandomGenerator &rng, BenchResult *result)
+{
+    vector<long long> live;
+    long long targetBytes = allocator.getTotalMemorySize() * config.occupancyPercent / 100;
+    long long usedBytes = 0;
+
+    while (usedBytes < targetBytes)
+    {
+        long long sizeBytes = randomBlockBytes(config, allocator.memoryUnitCount, rng);
+        long long location;
+
+        if (result) location = timedMalloc(allocator, sizeBytes, *result);
+        else location = allocator.mallocByType(sizeBytes);
+
+        if (location < 0) break; //full before target, fragmentation
+
+        live.push_back(location);
+        usedBytes += sizeBytes;
+    }
+
+    return live;
+}
+
+
+void runFill(MemoryAllocator &allocator, const BenchConfig &config, RandomGenerator &rng, BenchResult &result)
+{
+    fillToOccupancy(allocator, config, rng, &result);
+}
+
+
+void runChurn(MemoryAllocator &allocator, const BenchConfig &config, RandomGenerator &rng, BenchResult &result, int operations)
+{
+    vector<long long> live = fillToOccupancy(allocator, config, rng, nullptr);
+
+    long long startAllocOps = allocator.getNumberOfAllocationOperations(); //only count the timed part
+    long long startFreeOps = allocator.getNumberOfFreeOperations();
+
+    for (int i = 0; i < operations && !live.empty(); i++)
+    {
+        int pick = rng.randomInclusive(0, (int)live.size() - 1);
+        timedFree(allocator, live[pick], result);
+        live[pick] = live.back();
+        live.pop_back();
+
+        long long location = timedMalloc(allocator, randomBlockBytes(config, allocator.memoryUnitCount, rng), result);
+        if (location >= 0) live.push_back(location);
+    }
+
+    result.allocationOperations = allocator.getNumberOfAllocationOperations() - startAllocOps;
+    result.freeOperations = allocator.getNumberOfFreeOperations() - startFreeOps;
+}
+
+
+void runFragmented(MemoryAllocator &allocator, const BenchConfig &config, BenchResult &result, int operations)
+{
+    // small/large pairs up to ~95% then free the small ones, leaves many tiny holes
+    long long pairUnits = allocator.memoryUnitCount / config.liveBlocks;
+    if (pairUnits < 3) pairUnits = 3;
+
+    long long smallBytes = config.memoryUnitSize;
+    long long largeBytes = (pairUnits - 1) * config.memoryUnitSize;
+
+    vector<long long> smallLocations;
+    long long targetBytes = allocator.getTotalMemorySize() * 95 / 100;
+    long long usedBytes = 0;
+
+    while (usedBytes + smallBytes + largeBytes <= targetBytes)
+    {
+        long long smallLocation = allocator.mallocByType(smallBytes);
+        long long largeLocation = allocator.mallocByType(largeBytes);
+        if (smallLocation < 0 || largeLocation < 0) break;
+
+        smallLocations.push_back(smallLocation);
+        usedBytes += smallBytes + largeBytes;
+    }
+
+    for (size_t i = 0; i < smallLocations.size(); i++) allocator.freeFF(smallLocations[i]);
+
+    long long startAllocOps = allocator.getNumberOfAllocationOperations();
+    long long startFreeOps = allocator.getNumberOfFreeOperations();
+
+    // requests 2 units never fit a 1 unit hole, every scan walks past all holes
+    long long requestBytes = 2 * (long long)config.memoryUnitSize;
+    for (int i = 0; i < operations; i++)
+    {
+        long long location = timedMalloc(allocator, requestBytes, result);
+        if (location >= 0) timedFree(allocator, location, result);
+    }
+
+    result.allocationOperations = allocator.getNumberOfAllocationOperations() - startAllocOps;
+    result.freeOperations = allocator.getNumberOfFreeOperations() - startFreeOps;
+}
+
+
+// fewer timed ops on huge memories, scanning cost grows with unit count
+int scaledOperations(const BenchConfig &config, long long memoryUnitCount)
+{
+    long long operations = config.operations;
+    if (memoryUnitCount > 100000) operations = operations * 100000 / memoryUnitCount;
+    if (operations < 100) operations = 100;
+    return (int)operations;
+}
+
+
+vector<long long> parseCountList(const string &text)
+{
+    vector<long long> values;
+    size_t start = 0;
+
+    while (start < text.size())
+    {
+        size_t comma = text.find(',', start);
+        if (comma == string::npos) comma = text.size();
+
+        if (comma > start) values.push_back(stoll(text.substr(start, comma - start)));
+        start = comma + 1;
+    }
+
+    return values;
+}
+
+
+void printUsage()
+{
+    cout<<"Options:" << endl;
+    cout<<"--seed <unsigned>                 Seed for random sizes" << endl;
+    cout<<"--memoryUnitSize <int>            Memory unit size in bytes" << endl;
+    cout<<"--memoryUnitCounts <a,b,...>      Memory sizes in units, e.g. 1000,100000000" << endl;
+    cout<<"--occupancy <int>                 Fill target percent" << endl;
+    cout<<"--liveBlocks <int>                About how many blocks are live once filled" << endl;
+    cout<<"--operations <int>                Timed ops per churn scenario (scaled down above 10^5 units)" << endl;
+    cout<<"--engine <scan|indexed>           Allocator engine" << endl;
+    cout<<"--ownership <vector|runs|mmap>    Unit owner map (runs forces indexed)" << endl;
+    cout<<"--output <string>                 Results CSV path" << endl;
+}
+
+
+int main(int argc, char* argv[])
+{
+    BenchConfig config;
+
+    int i = 1;
+    while (i < argc)
+    {
+        string a = argv[i];
+
+        if (a == "--help")
+        {
+            printUsage();
+            return 0;
+        }
+
+        if (i + 1 >= argc) break;
+        string value = argv[i + 1];
+
+        if (a == "--seed") config.seed = (unsigned)stoul(value);
+        else if (a == "--memoryUnitSize") config.memoryUnitSize = stoi(value);
+        else if (a == "--memoryUnitCounts") config.memoryUnitCounts = parseCountList(value);
+        else if (a == "--occupancy") config.occupancyPercent = stoi(value);
+        else if (a == "--liveBlocks") config.liveBlocks = stoi(value);
+        else if (a == "--operations") config.operations = stoi(value);
+        else if (a == "--output") config.outputPath = value;
+        else if (a == "--engine") config.engineType = (value == "indexed") ? 1 : 0;
+        else if (a == "--ownership") config.ownershipType = (value == "runs") ? 1 : (value == "mmap") ? 2 : 0;
+        else
+        {
+            i++; //unknown arg, skip
+            continue;
+        }
+
+        i += 2;
+    }
+
+    if (config.memoryUnitSize <= 0 || config.liveBlocks <= 0 || config.occupancyPercent <= 0 || config.occupancyPercent > 100)
+    {
+        cout << "Invalid configuration. Exiting" << endl;
+        return 1;
+    }
+
+    const char *names[4] = {"First Fit", "Next Fit", "Best Fit", "Worst Fit"};
+    const char *shortNames[4] = {"FF", "NF", "BF", "WF"};
+    const char *scenarios[3] = {"fill", "churn", "fragmented"};
+
+    vector<BenchResult> results;
+
+    for (size_t m = 0; m < config.memoryUnitCounts.size(); m++)
+    {
+        long long memoryUnitCount = config.memoryUnitCounts[m];
+        int operations = scaledOperations(config, memoryUnitCount);
+
+        for (int s = 0; s < 3; s++)
+        {
+            for (int type = 0; type < 4; type++)
+            {
+                MemoryAllocator allocator;
+                allocator.algorithmType = type;
+                allocator.engineType = config.engineType;
+                allocator.ownershipType = config.ownershipType;
+                allocator.unitMapFilePath = "out/bench_unitmap.bin";
+                allocator.configure(config.memoryUnitSize, memoryUnitCount, names[type]);
+                allocator.setCurrentJobId(0);
+
+                RandomGenerator rng(config.seed); //same sizes for every algorithm
+
+                BenchResult result;
+                result.scenario = scenarios[s];
+                result.algorithm = shortNames[type];
+                result.memoryUnitCount = memoryUnitCount;
+
+                if (s == 0)
+                {
+                    runFill(allocator, config, rng, result);
+                    result.allocationOperations = allocator.getNumberOfAllocationOperations();
+                }
+                else if (s == 1) runChurn(allocator, config, rng, result, operations);
+                else runFragmented(allocator, config, result, operations); //fixed sizes, no draws
+
+                sort(result.latencies.begin(), result.latencies.end());
+                results.push_back(result);
+
+                cout << result.scenario << " " << result.algorithm << " units=" << memoryUnitCount
+                     << " ops=" << (result.mallocCount + result.freeCount) << "\n";
+            }
+        }
+    }
+
+
+    filesystem::path parent = filesystem::path(config.outputPath).parent_path();
+    if (!parent.empty())
+    {
+        error_code ec;
+        filesystem::create_directories(parent, ec);
+    }
+
+    CsvWriter writer(config.outputPath);
+    writer.header({"scenario", "algorithm", "memoryUnitCount", "mallocs", "frees", "failedMallocs",
+                   "nsPerOp", "p50Ns", "p99Ns", "allocationOperationsPerMalloc", "freeOperationsPerFree"});
+
+    string text = "Scenario,Algorithm,Units,ns/op,p50,p99,allocOps/malloc,freeOps/free\n";
+
+    for (size_t r = 0; r < results.size(); r++)
+    {
+        BenchResult &result = results[r];
+        long long ops = result.mallocCount + result.freeCount;
+
+        long long nsPerOp = 0;
+        long long allocOpsPerMalloc = 0;
+        long long freeOpsPerFree = 0;
+
+        if (ops > 0) nsPerOp = result.totalNanoseconds / ops;
+        if (result.mallocCount > 0) allocOpsPerMalloc = result.allocationOperations / result.mallocCount;
+        if (result.freeCount > 0) freeOpsPerFree = result.freeOperations / result.freeCount;
+
+        vector<string> row;
+        row.push_back(result.scenario);
+        row.push_back(result.algorithm);
+        row.push_back(to_string(result.memoryUnitCount));
+        row.push_back(to_string(result.mallocCount));
+        row.push_back(to_string(result.freeCount));
+        row.push_back(to_string(result.failedMallocs));
+        row.push_back(to_string(nsPerOp));
+        row.push_back(to_string(result.percentile(0.50)));
+        row.push_back(to_string(result.percentile(0.99)));
+        row.push_back(to_string(allocOpsPerMalloc));
+        row.push_back(to_string(freeOpsPerFree));
+        writer.row(row);
+
+        text += result.scenario + "," + result.algorithm + "," + to_string(result.memoryUnitCount) + ","
+              + to_string(nsPerOp) + "," + to_string(result.percentile(0.50)) + "," + to_string(result.percentile(0.99)) + ","
+              + to_string(allocOpsPerMalloc) + "," + to_string(freeOpsPerFree) + "\n";
+    }
+
+    writer.close();
+    cout << "\n" << text;
+    cout << "Results written to " << config.outputPath << endl;
+
+    return 0;
+}
@@ -0,0 +1,360 @@
+#include "batchrunner.h"
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <thread>
+#include <atomic>
+#include <set>
+
+
+BatchRunner::BatchRunner()
+{
+    threadCount = 1;
+    workloadsGenerated = 0;
+}
+
+
+void BatchRunner::configure(const SimulationConfig &baseConfigValue, int threads)
+{
+    baseConfig = baseConfigValue;
+
+    threadCount = threads;
+    if (threadCount <= 0) threadCount = (int)thread::hardware_concurrency();
+    if (threadCount <= 0) threadCount = 1; //unknown core count
+
+    filesystem::path parent = filesystem::path(baseConfig.summaryFilePath).parent_path();
+    resultsFilePath = (parent / "batch_results.csv").string();
+}
+
+
+bool BatchRunner::WorkloadKey::operator<(const WorkloadKey &other) const
+{
+    if (seed != other.seed) return seed < other.seed;
+    if (percentSmall != other.percentSmall) return percentSmall < other.percentSmall;
+    if (percentMedium != other.percentMedium) return percentMedium < other.percentMedium;
+    if (arrivalHorizon != other.arrivalHorizon) return arrivalHorizon < other.arrivalHorizon;
+    return maxHeapElements < other.maxHeapElements;
+}
+
+
+// plain comma split, test files dont need quoting
+vector<string> BatchRunner::splitLine(const string &line)
+{
+    vector<string> fields;
+    string field;
+    for (size_t i = 0; i <= line.size(); i++)
+    {
+        if (i == line.size() || line[i] == ',')
+        {
+            size_t first = field.find_first_not_of(" \t\r");
+            size_t last = field.find_last_not_of(" \t\r");
+            fields.push_back(first == string::npos ? "" : field.substr(first, last - first + 1));
+            field.clear();
+        }
+        else field += line[i];
+    }
+    return fields;
+}
+
+
+// the name becomes a directory, keep it to one plain path component
+bool BatchRunner::validName(const string &name)
+{
+    if (name.empty() || name == "." || name == "..") return false;
+    for (size_t i = 0; i < name.size(); i++)
+    {
+        char c = name[i];
+        bool plain = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '-' || c == '.';
+        if (!plain) return false;
+    }
+    return true;
+}
+
+
+// same keys and values as the command line flags, without the dashes
+bool BatchRunner::applyColumn(SimulationConfig &config, const string &column, const string &value, string &error)
+{
+    if (value.empty()) return true; //blank cell keeps the command line value
+
+    try
+    {
+        if (column == "testName") config.testName = value;
+        else if (column == "seed") config.seed = (unsigned)stoi(value);
+        else if (column == "memoryUnitSize") config.memoryUnitSize = stoi(value);
+        else if (column == "memoryUnitCount") config.memoryUnitCount = stoll(value);
+        else if (column == "percentSmall") config.percentSmall = stoi(value);
+        else if (column == "percentMedium") config.percentMedium = stoi(value);
+        else if (column == "percentLarge") config.percentLarge = stoi(value);
+        else if (column == "horizon") config.arrivalHorizon = stoi(value);
+        else if (column == "prefill") config.prefillTime = stoi(value);
+        else if (column == "sampleInterval") config.sampleInterval = stoi(value);
+        else if (column == "maxHeapElements") config.maxHeapElements = stoi(value);
+        else if (column == "batchAllocs") config.batchHeapAllocs = (stoi(value) != 0);
+        else if (column == "jobArenas") config.jobArenas = (stoi(value) != 0);
+        else if (column == "lifetimeAware") config.lifetimeAware = (stoi(value) != 0);
+        else if (column == "lifetimeThreshold") config.lifetimeThreshold = stoi(value);
+        else if (column == "admissionQueue") config.admissionQueue = (stoi(value) != 0);
+        else if (column == "steadyState") config.steadyState = (stoi(value) != 0);
+        else if (column == "engine")
+        {
+            if (value == "scan") config.engineType = 0;
+            else if (value == "indexed") config.engineType = 1;
+            else
+            {
+                error = "unknown engine " + value;
+                return false;
+            }
+        }
+        else if (column == "jobModel")
+        {
+            if (value == "prebuilt") config.jobModel = 0;
+            else if (value == "coroutine") config.jobModel = 1;
+            else
+            {
+                error = "unknown job model " + value;
+                return false;
+            }
+        }
+        else
+        {
+            error = "unknown column " + column;
+            return false;
+        }
+    }
+    catch (const exception &)
+    {
+        error = "bad value " + value + " for " + column;
+        return false;
+    }
+
+    return true;
+}
+
+
+bool BatchRunner::loadFile(const string &path)
+{
+    tests.clear();
+
+    ifstream in(path);
+    if (!in)
+    {
+        cout << "Error: could not read batch file " << path << endl;
+        return false;
+    }
+
+    vector<string> columns;
+    set<string> names;
+    string line;
+    int lineNumber = 0;
+
+    while (getline(in, line))
+    {
+        lineNumber++;
+
+        size_t first = line.find_first_not_of(" \t\r");
+        if (first == string::npos || line[first] == '#') continue;
+
+        vector<string> fields = splitLine(line);
+
+        if (columns.empty()) //first real line is the header
+        {
+            columns = fields;
+
+            bool hasName = false;
+            for (size_t c = 0; c < columns.size(); c++) if (columns[c] == "testName") hasName = true;
+            if (!hasName)
+            {
+                cout << "Error: batch file " << path << " needs a testName column" << endl;
+                return false;
+            }
+            continue;
+        }
+
+        if (fields.size() != columns.size())
+        {
+            cout << "Error: batch file line " << lineNumber << " has " << fields.size() << " fields, header has " << columns.size() << endl;
+            return false;
+        }
+
+        TestCase test;
+        test.config = baseConfig;
+        for (size_t c = 0; c < columns.size(); c++)
+        {
+            string error;
+            if (!applyColumn(test.config, columns[c], fields[c], error))
+            {
+                cout << "Error: batch file line " << lineNumber << ": " << error << endl;
+                return false;
+            }
+        }
+        test.name = test.config.testName;
+
+        // same checks main makes for a single run
+        if (!validName(test.name) || !names.insert(test.name).second)
+        {
+            cout << "Error: batch file line " << lineNumber << ": test name missing, not a plain file name, or used twice" << endl;
+            return false;
+        }
+        if (test.config.percentSmall + test.config.percentMedium + test.config.percentLarge != 100)
+        {
+            cout << "Error: batch file line " << lineNumber << ": percentSmall + percentMedium + percentLarge must add up to 100." << endl;
+            return false;
+        }
+        if (test.config.memoryUnitSize <= 0 || test.config.memoryUnitSize % 8 != 0 || test.config.memoryUnitCount <= 0)
+        {
+            cout << "Error: batch file line " << lineNumber << ": invalid memory configuration" << endl;
+            return false;
+        }
+
+        tests.push_back(test);
+    }
+
+    if (tests.empty())
+    {
+        cout << "Error: batch file " << path << " has no tests" << endl;
+        return false;
+    }
+
+    return true;
+}
+
+
+bool BatchRunner::run()
+{
+    reports.assign(tests.size(), SimulationReport());
+    testFailed.assign(tests.size(), 0);
+    testMessages.assign(tests.size(), string());
+    workloads.clear();
+    workloadsGenerated = 0;
+
+    atomic<int> next(0);
+    int last = (int)tests.size();
+    int workers = threadCount;
+    if (workers > last) workers = last;
+
+    // same pool as the replicas, each worker takes the next test in file order
+    vector<thread> pool;
+    for (int w = 0; w < workers; w++)
+    {
+        pool.push_back(thread([this, &next, last]()
+        {
+            while (true)
+            {
+                int index = next.fetch_add(1);
+                if (index >= last) break;
+                runTest(index);
+            }
+        }));
+    }
+
+    for (size_t w = 0; w < pool.size(); w++) pool[w].join();
+
+    for (size_t t = 0; t < tests.size(); t++) cout << testMessages[t]; //file order, workers never print
+
+    if (!writeResults(resultsFilePath))
+    {
+        cout << "Warning: could not write batch results " << resultsFilePath << "\n";
+    }
+
+    bool failed = false;
+    for (size_t t = 0; t < tests.size(); t++)
+    {
+        if (!testFailed[t]) continue;
+        cout << "Error: batch test " << tests[t].name << " failed" << endl;
+        failed = true;
+    }
+
+    if (baseConfig.textReport)
+    {
+        cout << "Batch: " << tests.size() << " tests on " << workers << " threads, " << workloadsGenerated << " workloads generated\n";
+        cout << "Results: " << resultsFilePath << "\n";
+    }
+
+    return !failed;
+}
+
+
+void BatchRunner::runTest(int index)
+{
+    SimulationConfig config = tests[index].config;
+    config.textReport = false; //one results file at the end instead
+
+    config.redirectOutputs(tests[index].name);
+
+    MemorySimulation simulation;
+    simulation.printMessages = false; //run() prints them after the pool joins
+    simulation.configure(config);
+
+    if (config.jobModel == 0 && config.checkpointLoadPath.empty()) simulation.sharedWorkload = findWorkload(config);
+
+    simulation.run();
+
+    reports[index] = simulation.report;
+    testMessages[index] = simulation.messages;
+    if (simulation.checkpointFailed || simulation.verifyFailed) testFailed[index] = 1;
+}
+
+
+shared_ptr<const MemorySimulation::Workload> BatchRunner::findWorkload(const SimulationConfig &config)
+{
+    WorkloadKey key;
+    key.seed = config.seed;
+    key.percentSmall = config.percentSmall;
+    key.percentMedium = config.percentMedium;
+    key.arrivalHorizon = config.arrivalHorizon;
+    key.maxHeapElements = config.maxHeapElements;
+
+    promise<shared_ptr<const MemorySimulation::Workload>> made;
+    shared_future<shared_ptr<const MemorySimulation::Workload>> ready;
+    bool generate = false;
+
+    {
+        lock_guard<mutex> lock(workloadMutex);
+        map<WorkloadKey, shared_future<shared_ptr<const MemorySimulation::Workload>>>::iterator it = workloads.find(key);
+        if (it == workloads.end())
+        {
+            ready = made.get_future().share();
+            workloads[key] = ready;
+            workloadsGenerated++;
+            generate = true;
+        }
+        else ready = it->second;
+    }
+
+    if (generate) made.set_value(MemorySimulation::generateWorkload(config)); //outside the lock, other keys keep going
+
+    return ready.get();
+}
+
+
+// long format, one line per test, algorithm and metric, in file order
+bool BatchRunner::writeResults(const string &path)
+{
+    if (path.empty()) return false;
+
+    filesystem::path parent = filesystem::path(path).parent_path();
+    if (!parent.empty())
+    {
+        error_code ec;
+        filesystem::create_directories(parent, ec); //errors go into ec
+    }
+
+    string text = "testName,algorithm,metric,value\n";
+    for (size_t t = 0; t < reports.size(); t++)
+    {
+        for (size_t a = 0; a < reports[t].algorithms.size(); a++)
+        {
+            const AlgorithmReport &algorithm = reports[t].algorithms[a];
+            for (size_t m = 0; m < algorithm.metrics.size(); m++)
+            {
+                text += tests[t].name + "," + algorithm.shortName + "," + algorithm.metrics[m].key + "," + to_string(algorithm.metrics[m].value) + "\n";
+            }
+        }
+    }
+
+    ofstream out(path, ios::binary);
+    if (!out) return false;
+
+    out.write(text.data(), (streamsize)text.size());
+    return (bool)out;
+}
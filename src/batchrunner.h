@@ -0,0 +1,73 @@
+#ifndef BATCHRUNNER_H
+#define BATCHRUNNER_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <future>
+#include "memorysimulation.h"
+#include "simulationreport.h"
+
+using namespace std;
+
+// --batch, a csv of named test cases run in one process on a pool of
+// threads. the header names the columns (testName plus any of the config
+// keys below), every other line is one test; blank lines and lines starting
+// with # are skipped, columns left out keep the command line values. each
+// test writes its normal outputs into <dir>/<testName>/ and its final
+// metrics go into one long format results csv. prebuilt tests with the same
+// seed, job mix, horizon and heap cap draw the same jobs, so that workload
+// is generated once and shared read only
+class BatchRunner
+{
+public:
+    BatchRunner();
+
+    void configure(const SimulationConfig &baseConfig, int threads);
+    bool loadFile(const string &path); //false + message on the first bad line
+
+    bool run(); //false if a test failed
+
+    struct TestCase
+    {
+        string name;
+        SimulationConfig config;
+    };
+
+    struct WorkloadKey
+    {
+        unsigned seed;
+        int percentSmall;
+        int percentMedium;
+        int arrivalHorizon;
+        int maxHeapElements;
+
+        bool operator<(const WorkloadKey &other) const;
+    };
+
+    SimulationConfig baseConfig;
+    int threadCount;
+
+    vector<TestCase> tests; //file order
+    vector<SimulationReport> reports; //one per test, same order
+    vector<char> testFailed; //written by one worker each
+    vector<string> testMessages; //warnings and verify result per test, printed by run()
+
+    // first test to need a workload generates it, the rest wait on the future
+    mutex workloadMutex;
+    map<WorkloadKey, shared_future<shared_ptr<const MemorySimulation::Workload>>> workloads;
+    int workloadsGenerated;
+
+    string resultsFilePath; //beside summary.csv
+
+    void runTest(int index);
+    shared_ptr<const MemorySimulation::Workload> findWorkload(const SimulationConfig &config);
+    bool writeResults(const string &path);
+
+    static bool applyColumn(SimulationConfig &config, const string &column, const string &value, string &error);
+    static bool validName(const string &name);
+    static vector<string> splitLine(const string &line);
+};
+
+#endif // BATCHRUNNER_H
@@ -0,0 +1,132 @@
+#include "binaryio.h"
+#include <filesystem>
+#include <fstream>
+#include <string.h>
+
+
+void BinaryWriter::writeBytes(const void *data, size_t size)
+{
+    buffer.append((const char *)data, size);
+}
+
+void BinaryWriter::writeInt(long long value)
+{
+    writeBytes(&value, sizeof(value));
+}
+
+void BinaryWriter::writeDouble(double value)
+{
+    writeBytes(&value, sizeof(value));
+}
+
+void BinaryWriter::writeString(const string &value)
+{
+    writeInt((long long)value.size());
+    writeBytes(value.data(), value.size());
+}
+
+void BinaryWriter::writeIntVector(const vector<long long> &values)
+{
+    writeInt((long long)values.size());
+    if (!values.empty()) writeBytes(values.data(), values.size() * sizeof(long long));
+}
+
+
+bool BinaryWriter::saveToFile(const string &path)
+{
+    if (path.empty()) return false;
+
+    filesystem::path parent = filesystem::path(path).parent_path();
+    if (!parent.empty())
+    {
+        error_code ec;
+        filesystem::create_directories(parent, ec); //errors go into ec
+    }
+
+    ofstream out(path, ios::binary);
+    if (!out) return false;
+
+    out.write(buffer.data(), (streamsize)buffer.size());
+    return (bool)out;
+}
+
+
+BinaryReader::BinaryReader()
+{
+    ok = true;
+    position = 0;
+}
+
+
+bool BinaryReader::loadFromFile(const string &path)
+{
+    ifstream in(path, ios::binary);
+    if (!in)
+    {
+        ok = false;
+        return false;
+    }
+
+    buffer.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+    position = 0;
+    ok = true;
+    return true;
+}
+
+
+bool BinaryReader::readBytes(void *data, size_t size)
+{
+    if (!ok || buffer.size() - position < size)
+    {
+        ok = false;
+        memset(data, 0, size);
+        return false;
+    }
+
+    memcpy(data, buffer.data() + position, size);
+    position += size;
+    return true;
+}
+
+long long BinaryReader::readInt()
+{
+    long long value = 0;
+    readBytes(&value, sizeof(value));
+    return value;
+}
+
+double BinaryReader::readDouble()
+{
+    double value = 0;
+    readBytes(&value, sizeof(value));
+    return value;
+}
+
+string BinaryReader::readString()
+{
+    long long size = readInt();
+    if (!ok || size < 0 || (size_t)size > buffer.size() - position)
+    {
+        ok = false;
+        return "";
+    }
+
+    string value = buffer.substr(position, (size_t)size);
+    position += (size_t)size;
+    return value;
+}
+
+vector<long long> BinaryReader::readIntVector()
+{
+    vector<long long> values;
+    long long size = readInt();
+    if (!ok || size < 0 || (size_t)size > (buffer.size() - position) / sizeof(long long))
+    {
+        ok = false;
+        return values;
+    }
+
+    values.resize((size_t)size);
+    if (size > 0) readBytes(values.data(), (size_t)size * sizeof(long long));
+    return values;
+}
@@ -0,0 +1,44 @@
+#ifndef BINARYIO_H
+#define BINARYIO_H
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// little helpers for checkpoint files, fixed 8 byte integers so a file
+// written by one build reads back in another on the same platform
+class BinaryWriter
+{
+public:
+    void writeBytes(const void *data, size_t size);
+    void writeInt(long long value);
+    void writeDouble(double value);
+    void writeString(const string &value);
+    void writeIntVector(const vector<long long> &values);
+
+    bool saveToFile(const string &path); //creates parent dir, one write
+
+    string buffer;
+};
+
+
+class BinaryReader
+{
+public:
+    BinaryReader();
+
+    bool loadFromFile(const string &path);
+
+    bool readBytes(void *data, size_t size); //false and ok=false on short read
+    long long readInt();
+    double readDouble();
+    string readString();
+    vector<long long> readIntVector();
+
+    bool ok;
+    string buffer;
+    size_t position;
+};
+
+#endif // BINARYIO_H
@@ -1,5 +1,4 @@
 #include "csvwriter.h"
-#include <fstream>
 using namespace std;
 
 
@@ -7,6 +6,30 @@ using namespace std;
 CsvWriter::CsvWriter(const string &path)
 {
     filePath = path;  //output file path, buffer start empty
+    asyncMode = false;
+    asyncBufferLimit = 1 << 20;
+    closed = false;
+    backBufferFull = false;
+    stopRequested = false;
+}
+
+
+CsvWriter::CsvWriter(const string &path, bool asyncModeValue)
+{
+    filePath = path;
+    asyncMode = asyncModeValue;
+    asyncBufferLimit = 1 << 20; //1MB per buffer
+    closed = false;
+    backBufferFull = false;
+    stopRequested = false;
+
+    if (asyncMode) startAsync();
+}
+
+
+CsvWriter::~CsvWriter()
+{
+    if (asyncMode && !closed) close(); //dont leave io thread running
 }
 
 
@@ -19,13 +42,33 @@ void CsvWriter::header(const vector<string> &columns) // CSV header to buffer
 void CsvWriter::row(const vector<string> &columns)
 { // add data row to buffer
     buffer += join(columns); // one csv line and append
+
+    if (asyncMode && buffer.size() >= asyncBufferLimit) handOffBuffer();
 }
 
 
 void CsvWriter::close()
 {
-    ofstream out(filePath); //open file to write
-    out << buffer; //write entire buffer to file
+    if (closed) return;
+    closed = true;
+
+    if (!asyncMode)
+    {
+        ofstream out(filePath); //open file to write
+        out << buffer; //write entire buffer to file
+        return;
+    }
+
+    if (!buffer.empty()) handOffBuffer(); //last partial buffer
+
+    {
+        lock_guard<mutex> lock(ioMutex);
+        stopRequested = true;
+    }
+    ioCondition.notify_all();
+
+    if (ioThread.joinable()) ioThread.join(); //waits for disk to catch up
+    asyncOut.close();
 }
 
 
@@ -46,3 +89,54 @@ string CsvWriter::join(const vector<string> &v)
 
     return s;
 }
+
+
+void CsvWriter::startAsync()
+{
+    asyncOut.open(filePath); //open now so io thread can stream into it
+    buffer.reserve(asyncBufferLimit + 256);
+    backBuffer.reserve(asyncBufferLimit + 256);
+    ioThread = thread(&CsvWriter::ioLoop, this);
+}
+
+
+void CsvWriter::handOffBuffer()
+{
+    unique_lock<mutex> lock(ioMutex);
+
+    //back pressure, both buffers full so wait for io thread
+    ioCondition.wait(lock, [this] { return !backBufferFull; });
+
+    buffer.swap(backBuffer); //drained back buffer becomes the new front
+    backBufferFull = true;
+    lock.unlock();
+
+    ioCondition.notify_all();
+    buffer.clear(); //keeps capacity
+}
+
+
+void CsvWriter::ioLoop()
+{
+    unique_lock<mutex> lock(ioMutex);
+
+    while (true)
+    {
+        ioCondition.wait(lock, [this] { return backBufferFull || stopRequested; });
+
+        if (backBufferFull)
+        {
+            lock.unlock(); //sim thread doesnt touch backBuffer while its full
+            asyncOut.write(backBuffer.data(), (streamsize)backBuffer.size());
+            lock.lock();
+
+            backBuffer.clear();
+            backBufferFull = false;
+            ioCondition.notify_all();
+        }
+
+        else if (stopRequested) break; //nothing left to drain
+    }
+
+    asyncOut.flush();
+}
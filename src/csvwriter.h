@@ -2,11 +2,18 @@
 #define CSVWRITER_H
 #include <string>
 #include <vector>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 using namespace std;
 
 class CsvWriter {
 public:
     CsvWriter(const string &path);
+    CsvWriter(const string &path, bool asyncModeValue); //async = background io thread
+    ~CsvWriter();
+
     void header(const vector<string> &columns); //csv header (index and arrival time)
     void row(const vector<string> &columns); //csv data
     void close();
@@ -14,6 +21,25 @@ public:
     string filePath;
     string buffer;
     string join(const vector<string> &v); // for commas
+
+    // async mode, double buffered:
+    // row() fills buffer while the io thread drains backBuffer to disk
+    bool asyncMode;
+    size_t asyncBufferLimit; // bytes in buffer before handing it to io thread
+    bool closed;
+
+    string backBuffer;
+    bool backBufferFull; // io thread owns backBuffer while true
+    bool stopRequested;
+
+    ofstream asyncOut;
+    thread ioThread;
+    mutex ioMutex;
+    condition_variable ioCondition;
+
+    void startAsync();
+    void handOffBuffer(); // swap buffers, only waits if io thread still busy
+    void ioLoop();
 };
 
 #endif // CSVWRITER_H
@@ -0,0 +1,192 @@
+#include "eventcalendar.h"
+
+
+EventCalendar::EventCalendar()
+{
+    currentTime = 0;
+    wheelMask = 0;
+    pendingCount = 0;
+    lastTime = -1;
+    reset(0);
+}
+
+
+void EventCalendar::reset(int startTime, int wheelTicks)
+{
+    int size = 1;
+    while (size < wheelTicks) size *= 2;
+
+    buckets.assign(size, Bucket());
+    farEvents.clear();
+    currentTime = startTime;
+    wheelMask = size - 1;
+    pendingCount = 0;
+    lastTime = -1;
+}
+
+
+int EventCalendar::typeSlot(int eventType)
+{
+    if (eventType < 0 || eventType >= eventTypeCount) return eventTypeCount - 1;
+    return eventType;
+}
+
+
+void EventCalendar::schedule(int time, const ScheduledEvent &ev)
+{
+    if (time < currentTime) time = currentTime; //late, run it now
+
+    if (time > lastTime) lastTime = time;
+    pendingCount++;
+
+    if (time - currentTime <= wheelMask) buckets[time & wheelMask].byType[typeSlot(ev.eventType)].push_back(ev);
+    else farEvents[time].push_back(ev);
+}
+
+
+void EventCalendar::clearBucket(Bucket &bucket)
+{
+    for (int t = 0; t < eventTypeCount; t++)
+    {
+        pendingCount -= (long long)(bucket.byType[t].size() - bucket.cursor[t]); //skipped ticks drop what they had
+        bucket.byType[t].clear(); //keeps capacity for the next lap
+        bucket.cursor[t] = 0;
+    }
+}
+
+
+void EventCalendar::advanceTo(int time)
+{
+    while (currentTime < time)
+    {
+        clearBucket(buckets[currentTime & wheelMask]);
+        currentTime++;
+
+        // tick that just came into reach
+        int newestTick = currentTime + wheelMask;
+        while (!farEvents.empty() && farEvents.begin()->first <= newestTick)
+        {
+            map<int, vector<ScheduledEvent>>::iterator it = farEvents.begin();
+            Bucket &bucket = buckets[it->first & wheelMask];
+
+            for (size_t i = 0; i < it->second.size(); i++) bucket.byType[typeSlot(it->second[i].eventType)].push_back(it->second[i]);
+            farEvents.erase(it);
+        }
+    }
+}
+
+
+bool EventCalendar::popNext(int time, ScheduledEvent &ev)
+{
+    if (time < currentTime) return false; //already past
+    advanceTo(time);
+
+    Bucket &bucket = buckets[time & wheelMask];
+    for (int t = 0; t < eventTypeCount; t++)
+    {
+        if (bucket.cursor[t] < bucket.byType[t].size())
+        {
+            ev = bucket.byType[t][bucket.cursor[t]];
+            bucket.cursor[t]++;
+            pendingCount--;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+bool EventCalendar::peekType(int time, int &eventType)
+{
+    if (time < currentTime) return false;
+    advanceTo(time);
+
+    Bucket &bucket = buckets[time & wheelMask];
+    for (int t = 0; t < eventTypeCount; t++)
+    {
+        if (bucket.cursor[t] < bucket.byType[t].size())
+        {
+            eventType = bucket.byType[t][bucket.cursor[t]].eventType;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+long long EventCalendar::size() {return pendingCount;}
+int EventCalendar::getLastTime() {return lastTime;}
+
+
+void EventCalendar::collect(vector<pair<int, ScheduledEvent>> &pending)
+{
+    pending.clear();
+
+    for (int offset = 0; offset <= wheelMask; offset++)
+    {
+        int time = currentTime + offset;
+        Bucket &bucket = buckets[time & wheelMask];
+
+        for (int t = 0; t < eventTypeCount; t++)
+        {
+            for (size_t i = bucket.cursor[t]; i < bucket.byType[t].size(); i++) pending.push_back(make_pair(time, bucket.byType[t][i]));
+        }
+    }
+
+    for (map<int, vector<ScheduledEvent>>::iterator it = farEvents.begin(); it != farEvents.end(); ++it)
+    {
+        for (size_t i = 0; i < it->second.size(); i++) pending.push_back(make_pair(it->first, it->second[i]));
+    }
+}
+
+
+void EventCalendar::saveState(BinaryWriter &out)
+{
+    vector<pair<int, ScheduledEvent>> pending;
+    collect(pending);
+
+    out.writeInt(wheelMask + 1);
+    out.writeInt(currentTime);
+    out.writeInt(lastTime);
+    out.writeInt((long long)pending.size());
+
+    for (size_t i = 0; i < pending.size(); i++)
+    {
+        const ScheduledEvent &ev = pending[i].second;
+        out.writeInt(pending[i].first);
+        out.writeInt(ev.time);
+        out.writeInt(ev.jobId);
+        out.writeInt(ev.elementId);
+        out.writeInt(ev.eventType);
+    }
+}
+
+
+bool EventCalendar::loadState(BinaryReader &in)
+{
+    int wheelTicks = (int)in.readInt();
+    int startTime = (int)in.readInt();
+    int savedLastTime = (int)in.readInt();
+    long long count = in.readInt();
+    if (!in.ok || wheelTicks <= 0 || count < 0) return false;
+
+    reset(startTime, wheelTicks);
+
+    for (long long i = 0; i < count && in.ok; i++) //pop order in, same order out
+    {
+        int time = (int)in.readInt();
+
+        ScheduledEvent ev;
+        ev.time = (int)in.readInt();
+        ev.jobId = (int)in.readInt();
+        ev.elementId = (int)in.readInt();
+        ev.eventType = (int)in.readInt();
+
+        schedule(time, ev);
+    }
+
+    lastTime = savedLastTime;
+    return in.ok;
+}
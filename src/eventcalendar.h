@@ -0,0 +1,76 @@
+#ifndef EVENTCALENDAR_H
+#define EVENTCALENDAR_H
+
+#include <map>
+#include <vector>
+#include "binaryio.h"
+
+using namespace std;
+
+struct ScheduledEvent
+{
+    int time;
+    int jobId;
+    int elementId;
+    int eventType; // 0=job arrive  1=job depart  2=heap alloc   3=heap free
+
+    ScheduledEvent()
+    {
+        time = 0;
+        jobId = -1;
+        elementId = -1;
+        eventType = 0;
+    }
+};
+
+
+// calendar queue / timing wheel keyed by tick. one bucket per tick for the
+// next wheelTicks ticks, each bucket a fifo per event type, so schedule and
+// popNext are O(1) and a tick comes out in (eventType, insertion) order.
+// events past the wheel wait in an ordered far list and move into their
+// bucket as the wheel turns, before anything else can land there
+class EventCalendar
+{
+public:
+    static const int eventTypeCount = 4;
+
+    EventCalendar();
+
+    void reset(int startTime, int wheelTicks = 4096); //wheelTicks rounded up to a power of two
+
+    void schedule(int time, const ScheduledEvent &ev); //time before the current tick runs at the current tick
+    bool popNext(int time, ScheduledEvent &ev); //next event of tick time, false once the tick is empty
+    bool peekType(int time, int &eventType); //type popNext would return, without taking it
+
+    long long size(); //pending events
+    int getLastTime(); //latest time ever scheduled, -1 if none
+
+    void collect(vector<pair<int, ScheduledEvent>> &pending); //(time, event) in pop order
+
+    void saveState(BinaryWriter &out); //checkpoint, pending events in pop order
+    bool loadState(BinaryReader &in);
+
+    struct Bucket
+    {
+        vector<ScheduledEvent> byType[eventTypeCount];
+        size_t cursor[eventTypeCount]; //next one to pop
+
+        Bucket()
+        {
+            for (int t = 0; t < eventTypeCount; t++) cursor[t] = 0;
+        }
+    };
+
+    vector<Bucket> buckets;
+    map<int, vector<ScheduledEvent>> farEvents; //time -> events, beyond the wheel
+    int currentTime;
+    int wheelMask;
+    long long pendingCount;
+    int lastTime;
+
+    void advanceTo(int time); //turn the wheel, pull in far events that now fit
+    void clearBucket(Bucket &bucket);
+    int typeSlot(int eventType); //out of range types go last
+};
+
+#endif // EVENTCALENDAR_H
@@ -0,0 +1,146 @@
+#include "freeblockindex.h"
+
+
+static const int sizeClassCount = 64;
+
+
+FreeBlockIndex::FreeBlockIndex()
+{
+    freeUnits = 0;
+    classBlocks.assign(sizeClassCount, 0);
+    classUnits.assign(sizeClassCount, 0);
+}
+
+
+void FreeBlockIndex::reset(long long memoryUnitCount)
+{
+    blocksByStart.clear();
+    blocksBySize.clear();
+    freeUnits = 0;
+    classBlocks.assign(sizeClassCount, 0);
+    classUnits.assign(sizeClassCount, 0);
+
+    if (memoryUnitCount > 0) insertBlock(0, memoryUnitCount);
+}
+
+
+void FreeBlockIndex::insertBlock(long long startIndex, long long length)
+{
+    blocksByStart[startIndex] = length;
+    blocksBySize.insert(make_pair(length, startIndex));
+    freeUnits += length;
+
+    int sizeClass = sizeClassOf(length);
+    classBlocks[sizeClass]++;
+    classUnits[sizeClass] += length;
+}
+
+
+void FreeBlockIndex::eraseBlock(map<long long, long long>::iterator it)
+{
+    blocksBySize.erase(make_pair(it->second, it->first));
+    freeUnits -= it->second;
+
+    int sizeClass = sizeClassOf(it->second);
+    classBlocks[sizeClass]--;
+    classUnits[sizeClass] -= it->second;
+    blocksByStart.erase(it);
+}
+
+
+void FreeBlockIndex::allocate(long long startIndex, long long unitCount)
+{
+    if (unitCount <= 0 || blocksByStart.empty()) return;
+
+    map<long long, long long>::iterator it = blocksByStart.upper_bound(startIndex);
+    if (it == blocksByStart.begin()) return; //nothing starts at or before, not free
+    --it;
+
+    long long blockStart = it->first;
+    long long blockEnd = it->first + it->second;
+    long long end = startIndex + unitCount;
+
+    if (end > blockEnd) return; //not inside this block, caller bug
+
+    eraseBlock(it);
+
+    if (startIndex > blockStart) insertBlock(blockStart, startIndex - blockStart); //left over before
+    if (end < blockEnd) insertBlock(end, blockEnd - end); //left over after
+}
+
+
+void FreeBlockIndex::release(long long startIndex, long long unitCount)
+{
+    if (unitCount <= 0) return;
+
+    long long start = startIndex;
+    long long end = startIndex + unitCount;
+
+    // merge with block right after
+    map<long long, long long>::iterator next = blocksByStart.lower_bound(start);
+    if (next != blocksByStart.end() && next->first < end) return; //overlaps free space, caller bug
+    if (next != blocksByStart.end() && next->first == end)
+    {
+        end = next->first + next->second;
+        eraseBlock(next);
+    }
+
+    // merge with block right before
+    map<long long, long long>::iterator prev = blocksByStart.lower_bound(start);
+    if (prev != blocksByStart.begin())
+    {
+        --prev;
+        long long prevEnd = prev->first + prev->second;
+
+        if (prevEnd > start) return; //overlap
+        if (prevEnd == start)
+        {
+            start = prev->first;
+            eraseBlock(prev);
+        }
+    }
+
+    insertBlock(start, end - start);
+}
+
+
+long long FreeBlockIndex::getBlockCount() {return (long long)blocksByStart.size();}
+long long FreeBlockIndex::getFreeUnits() {return freeUnits;}
+
+long long FreeBlockIndex::getLargestBlock()
+{
+    if (blocksBySize.empty()) return 0;
+    return blocksBySize.rbegin()->first;
+}
+
+long long FreeBlockIndex::getSmallestBlock()
+{
+    if (blocksBySize.empty()) return 0;
+    return blocksBySize.begin()->first;
+}
+
+
+int FreeBlockIndex::sizeClassOf(long long length)
+{
+    if (length <= 1) return 0;
+    return 63 - __builtin_clzll((unsigned long long)length); //floor(log2)
+}
+
+
+// classes above the one requiredUnits falls in fit whole, only blocks of
+// that one class are looked at one by one
+long long FreeBlockIndex::getUsableUnits(long long requiredUnits)
+{
+    if (requiredUnits <= 1) return freeUnits;
+
+    int sizeClass = sizeClassOf(requiredUnits);
+
+    long long usable = 0;
+    for (int k = sizeClass + 1; k < sizeClassCount; k++) usable += classUnits[k];
+
+    long long classEnd = 1LL << (sizeClass + 1); //first length of the next class
+    set<pair<long long, long long>>::iterator it = blocksBySize.lower_bound(make_pair(requiredUnits, (long long)-1));
+    for (; it != blocksBySize.end() && it->first < classEnd; ++it) usable += it->first;
+
+    return usable;
+}
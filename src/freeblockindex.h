@@ -0,0 +1,42 @@
+#ifndef FREEBLOCKINDEX_H
+#define FREEBLOCKINDEX_H
+
+#include <map>
+#include <set>
+#include <vector>
+
+using namespace std;
+
+// ordered index of free blocks (maximal runs of free units)
+// kept next to unitJobId so searches and metrics dont have to walk every unit
+class FreeBlockIndex
+{
+public:
+    FreeBlockIndex();
+
+    void reset(long long memoryUnitCount); //everything free, one block
+    void allocate(long long startIndex, long long unitCount); //range must sit inside one free block
+    void release(long long startIndex, long long unitCount); //merges with free neighbours
+
+    long long getBlockCount();
+    long long getFreeUnits();
+    long long getLargestBlock(); //0 if none
+    long long getSmallestBlock();
+
+    // log2 size classes, class k holds blocks of 2^k to 2^(k+1)-1 units,
+    // updated by insertBlock/eraseBlock so reading them costs no walk
+    static int sizeClassOf(long long length);
+    long long getUsableUnits(long long requiredUnits); //free units in blocks that could hold requiredUnits
+
+    map<long long, long long> blocksByStart;     //start -> length, address order
+    set<pair<long long, long long>> blocksBySize; //(length, start), smallest first
+
+    long long freeUnits;
+    vector<long long> classBlocks; //blocks per size class
+    vector<long long> classUnits; //free units per size class
+
+    void insertBlock(long long startIndex, long long length);
+    void eraseBlock(map<long long, long long>::iterator it);
+};
+
+#endif // FREEBLOCKINDEX_H
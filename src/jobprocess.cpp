@@ -0,0 +1,75 @@
+#include "jobprocess.h"
+
+
+JobProcess::JobProcess()
+{
+    coroutine = nullptr;
+    jobId = -1;
+}
+
+
+JobProcess::JobProcess(coroutine_handle<promise_type> handle)
+{
+    coroutine = handle;
+    jobId = -1;
+}
+
+
+JobProcess::JobProcess(JobProcess &&other) noexcept
+{
+    coroutine = other.coroutine;
+    jobId = other.jobId;
+    other.coroutine = nullptr;
+}
+
+
+JobProcess &JobProcess::operator=(JobProcess &&other) noexcept
+{
+    if (this == &other) return *this;
+
+    if (coroutine) coroutine.destroy();
+    coroutine = other.coroutine;
+    jobId = other.jobId;
+    other.coroutine = nullptr;
+    return *this;
+}
+
+
+JobProcess::~JobProcess()
+{
+    if (coroutine) coroutine.destroy(); //frees the frame, finished or not
+}
+
+
+void JobProcess::runTick(int time, vector<ScheduledEvent> &events)
+{
+    if (!coroutine) return;
+
+    promise_type &promise = coroutine.promise();
+
+    // a yield leaves wakeTime alone, so this keeps going until the body
+    // waits for a later tick or runs off its end
+    while (!coroutine.done() && promise.wakeTime <= time)
+    {
+        coroutine.resume();
+
+        if (promise.hasEvent)
+        {
+            events.push_back(promise.yielded);
+            promise.hasEvent = false;
+        }
+    }
+}
+
+
+bool JobProcess::done()
+{
+    return !coroutine || coroutine.done();
+}
+
+
+int JobProcess::getWakeTime()
+{
+    if (!coroutine) return -1;
+    return coroutine.promise().wakeTime;
+}
@@ -0,0 +1,69 @@
+#ifndef JOBPROCESS_H
+#define JOBPROCESS_H
+
+#include <coroutine>
+#include <exception>
+#include <vector>
+#include "eventcalendar.h"
+
+using namespace std;
+
+// a job as a c++20 coroutine. the body co_awaits the next tick it has
+// something to do and co_yields that tick's events, so only the frames of
+// live jobs are kept instead of every future event
+class JobProcess
+{
+public:
+    struct promise_type
+    {
+        ScheduledEvent yielded;
+        bool hasEvent;
+        int wakeTime; //tick the body is waiting for, -1 before it first runs
+
+        promise_type()
+        {
+            hasEvent = false;
+            wakeTime = -1;
+        }
+
+        JobProcess get_return_object() {return JobProcess(coroutine_handle<promise_type>::from_promise(*this));}
+        suspend_always initial_suspend() noexcept {return suspend_always();}
+        suspend_always final_suspend() noexcept {return suspend_always();}
+        void return_void() {}
+        void unhandled_exception() {terminate();}
+
+        suspend_always yield_value(const ScheduledEvent &ev)
+        {
+            yielded = ev;
+            hasEvent = true;
+            return suspend_always();
+        }
+    };
+
+    struct WaitUntil // co_await JobProcess::WaitUntil{time}
+    {
+        int time;
+
+        bool await_ready() noexcept {return false;}
+        void await_suspend(coroutine_handle<promise_type> handle) noexcept {handle.promise().wakeTime = time;}
+        void await_resume() noexcept {}
+    };
+
+    JobProcess();
+    explicit JobProcess(coroutine_handle<promise_type> handle);
+    JobProcess(JobProcess &&other) noexcept;
+    JobProcess &operator=(JobProcess &&other) noexcept;
+    ~JobProcess();
+
+    JobProcess(const JobProcess &) = delete;
+    JobProcess &operator=(const JobProcess &) = delete;
+
+    void runTick(int time, vector<ScheduledEvent> &events); //resume while it has work at time, appends what it yields
+    bool done();
+    int getWakeTime();
+
+    coroutine_handle<promise_type> coroutine;
+    int jobId;
+};
+
+#endif // JOBPROCESS_H
@@ -9,6 +9,8 @@
 #include <fstream>
 #include <string>
 #include "memorysimulation.h"
+#include "replicarunner.h"
+#include "batchrunner.h"
 
 using namespace std;
 
@@ -24,13 +26,59 @@ void printUsage()
     cout<<"--percentMedium <int>                    Medium jobs percent" << endl;
     cout<<"--percentLarge <int>                     Large jobs percent" << endl;
     cout<<"--memoryUnitSize <int>                   Memory unit size (must be multiple of 8)" << endl;
-    cout<<"--memoryUnitCount <int>                  Number of memory units" << endl;
+    cout<<"--memoryUnitCount <int>                  Number of memory units (64 bit)" << endl;
     cout<<"--testName <string>                      Simulation test name" << endl;
     cout<<"--summaryFilePath <string>               Summary CSV output path" << endl;
     cout<<"--logFileFirstFit <string>               First Fit log CSV output path" << endl;
     cout<<"--logFileNextFit <string>                Next Fit log CSV output path" << endl;
     cout<<"--logFileBestFit <string>                Best Fit log CSV output path" << endl;
     cout<<"--logFileWorstFit <string>               Worst Fit log CSV output path" << endl;
+    cout<<"--asyncLogs <0|1>                        Write logs on a background thread" << endl;
+    cout<<"--logLevel <none|failures|sampled|full>  Which alloc/free events get logged" << endl;
+    cout<<"--logSampleEvery <int>                   Sampled level logs 1 in N events" << endl;
+
+
+    cout<<"--reportFilePath <string>                Final statistics JSON output path" << endl;
+    cout<<"--textReport <0|1>                       Print the human readable report" << endl;
+    cout<<"--profile <0|1>                          Time each phase and algorithm of the run" << endl;
+    cout<<"--engine <scan|indexed>                  Allocator engine (indexed = free block index)" << endl;
+    cout<<"--verify <0|1>                           Run scan and indexed engines side by side and compare" << endl;
+    cout<<"--ownership <vector|runs|mmap>           Unit owner map, runs = run length encoded (forces indexed), mmap = file backed" << endl;
+    cout<<"--unitMapFile <string>                   Path prefix of the mmap owner maps (default out/unitmap)" << endl;
+    cout<<"--checkpointSave <string>                Write a state snapshot after --checkpointTime" << endl;
+    cout<<"--checkpointTime <int>                   Tick to snapshot after (default end of prefill, --prefill)" << endl;
+    cout<<"--checkpointLoad <string>                Continue from a snapshot instead of time 0" << endl;
+    cout<<"--batchAllocs <0|1>                      Place each tick's heap allocs in one pass (default 1)" << endl;
+    cout<<"--jobArenas <0|1>                        Release all of a job's blocks in one request on departure" << endl;
+    cout<<"--orphanPolicy <free|keep>               Heap alive at departure: free with the job or keep until its own free" << endl;
+    cout<<"--lifetimeAware <0|1>                    Add the Lifetime Aware (LA) algorithm as a 5th lane" << endl;
+    cout<<"--lifetimeThreshold <int>                LA: lifetimes up to this many ticks go low, longer go high (default 5)" << endl;
+    cout<<"--logFileLifetimeAware <string>          Lifetime Aware log CSV output path" << endl;
+    cout<<"--jobModel <prebuilt|coroutine>          Build every event up front, or run each job as a coroutine that makes its events as it goes" << endl;
+    cout<<"--admissionQueue <0|1>                   Requests that dont fit wait and retry after frees, adds wait and slowdown metrics" << endl;
+    cout<<"--horizon <int>                          Jobs arrive before this tick (default 2000)" << endl;
+    cout<<"--prefill <int>                          Ticks before the first sample (default 2000)" << endl;
+    cout<<"--sampleInterval <int>                   Ticks between samples (default 200)" << endl;
+    cout<<"--maxHeapElements <int>                  Stop adding heap elements to new jobs past this many (default 20000)" << endl;
+    cout<<"--steadyState <0|1>                      Sample from detected steady state instead of --prefill, stop once confident" << endl;
+    cout<<"--steadyWindow <int>                     Steady state: samples per window and per batch (default 10)" << endl;
+    cout<<"--steadyTolerance <double>               Steady state: drift between the window halves, percent of their mean (default 10)" << endl;
+    cout<<"--steadyHalfWidth <double>               Steady state: stop at a 95% interval within this percent of the mean (default 5)" << endl;
+    cout<<"--replicas <int>                         Run this many seeds (seed, seed+1, ...) in parallel, report mean, std dev and 95% CI" << endl;
+    cout<<"--threads <int>                          Replicas and --batch: worker threads (default all cores)" << endl;
+    cout<<"--replicaHalfWidth <double>              Replicas: add rounds of --replicas seeds until the 95% CI is within this percent of the mean" << endl;
+    cout<<"--replicaMetric <string>                 Replicas: metric the stop rule checks (default avgPercentMemoryInUse)" << endl;
+    cout<<"--maxReplicas <int>                      Replicas: stop adding rounds here (default 100)" << endl;
+    cout<<"--timeSeries <string>                    Binary per event series of allocated, required, free blocks and largest free block" << endl;
+    cout<<"--decodeTimeSeries <string>              Turn a --timeSeries file into CSV (--decodeOutput, default out/timeseries.csv) and exit" << endl;
+    cout<<"--freeBlockHistogram <string>            CSV of each algorithm's log2 free block size histogram at every sample" << endl;
+    cout<<"--usableSize <int>                       Histogram: bytes of the request the usable share is for (default 50)" << endl;
+    cout<<"--heatmap <string>                       Occupancy image per algorithm, <prefix>_FF.pgm, time across, address down" << endl;
+    cout<<"--heatmapRows <int>                      Heatmap: address buckets (default 256)" << endl;
+    cout<<"--heatmapInterval <int>                  Heatmap: ticks between columns (default 10)" << endl;
+    cout<<"--heatmapColumns <int>                   Heatmap: widest image, longer runs merge columns (default 1024)" << endl;
+    cout<<"--batch <path>                           Run every test in a csv (header testName,seed,...) in one process, uses --threads" << endl;
+    cout<<"--perfCounters <0|1>                     Hardware counters per algorithm (Linux, implies --profile)" << endl;
 
 
     cout<<"Note: percentSmall + percentMedium + percentLarge must equal 100." << endl;
@@ -47,6 +95,17 @@ int main(int argc, char* argv[])
 
     SimulationConfig simulationConfig;
 
+    int replicaCount = 0; // --replicas, 0 = a single run
+    int replicaThreads = 0; //0 = all cores
+    double replicaHalfWidth = 0; //sequential stopping off
+    string replicaMetric = "avgPercentMemoryInUse";
+    int maxReplicas = 100;
+
+    string batchFilePath; // --batch, csv of named tests run in this process
+
+    string decodeTimeSeriesPath; // --decodeTimeSeries, decode only, no simulation
+    string decodeOutputPath = "out/timeseries.csv";
+
     simulationConfig.seed= generatorConfig.seed;
     // keep simulation seed in sync with generator
 
@@ -134,7 +193,7 @@ int main(int argc, char* argv[])
         {
             if (i + 1 < argc)
             {
-                simulationConfig.memoryUnitCount = stoi(string(argv[i + 1]));
+                simulationConfig.memoryUnitCount = stoll(string(argv[i + 1]));
                 i += 2;
             }
             else break;
@@ -208,12 +267,560 @@ int main(int argc, char* argv[])
         }
 
 
+        else if (a =="--asyncLogs")
+        {
+            if (i + 1 < argc)
+            {
+                simulationConfig.asyncLogWriter = (stoi(string(argv[i + 1])) != 0);
+                i += 2;
+            }
+            else break;
+        }
+
+
+        else if (a =="--logLevel")
+        {
+            if (i + 1 < argc)
+            {
+                string level = string(argv[i + 1]);
+
+                if (level == "none") simulationConfig.logLevel = 0;
+                else if (level == "failures") simulationConfig.logLevel = 1;
+                else if (level == "sampled") simulationConfig.logLevel = 2;
+                else if (level == "full") simulationConfig.logLevel = 3;
+                else
+                {
+                    cout << "Error: unknown log level " << level << endl;
+                    return 1;
+                }
+                i += 2;
+            }
+            else break;
+        }
+
+
+        else if (a =="--logSampleEvery")
+        {
+            if (i + 1 < argc)
+            {
+                simulationConfig.logSampleEvery = stoi(string(argv[i + 1]));
+                i += 2;
+            }
+            else break;
+        }
+
+
+        else if (a =="--reportFilePath")
+        {
+            if (i + 1 < argc)
+            {
+                simulationConfig.reportFilePath = string(argv[i + 1]);
+                i += 2;
+            }
+            else break;
+        }
+
+
+        else if (a =="--textReport")
+        {
+            if (i + 1 < argc)
+            {
+                simulationConfig.textReport = (stoi(string(argv[i + 1])) != 0);
+                i += 2;
+            }
+            else break;
+        }
+
+
+        else if (a =="--profile")
+        {
+            if (i + 1 < argc)
+            {
+                simulationConfig.profile = (stoi(string(argv[i + 1])) != 0);
+                i += 2;
+            }
+            else break;
+        }
+
+
+        else if (a =="--perfCounters")
+        {
+            if (i + 1 < argc)
+            {
+                simulationConfig.perfCounters = (stoi(string(argv[i + 1])) != 0);
+                i += 2;
+            }
+            else break;
+        }
+
+
+        else if (a =="--engine")
+        {
+            if (i + 1 < argc)
+            {
+                string engine = string(argv[i + 1]);
+
+                if (engine == "scan") simulationConfig.engineType = 0;
+                else if (engine == "indexed") simulationConfig.engineType = 1;
+                else
+                {
+                    cout << "Error: unknown engine " << engine << endl;
+                    return 1;
+                }
+                i += 2;
+            }
+            else break;
+        }
+
+
+        else if (a =="--verify")
+        {
+            if (i + 1 < argc)
+            {
+                simulationConfig.verifyEngines = (stoi(string(argv[i + 1])) != 0);
+                i += 2;
+            }
+            else break;
+        }
+
+
+        else if (a =="--ownership")
+        {
+            if (i + 1 < argc)
+            {
+                string ownership = string(argv[i + 1]);
+
+                if (ownership == "vector") simulationConfig.ownershipType = 0;
+                else if (ownership == "runs") simulationConfig.ownershipType = 1;
+                else if (ownership == "mmap") simulationConfig.ownershipType = 2;
+                else
+                {
+                    cout << "Error: unknown ownership map " << ownership << endl;
+                    return 1;
+                }
+                i += 2;
+            }
+            else break;
+        }
+
+
+        else if (a =="--unitMapFile")
+        {
+            if (i + 1 < argc)
+            {
+                simulationConfig.unitMapFilePrefix = string(argv[i + 1]);
+                i += 2;
+            }
+            else break;
+        }
+
+
+        else if (a =="--checkpointSave")
+        {
+            if (i + 1 < argc)
+            {
+                simulationConfig.checkpointSavePath = string(argv[i + 1]);
+                i += 2;
+            }
+            else break;
+        }
+
+
+        else if (a =="--checkpointTime")
+        {
+            if (i + 1 < argc)
+            {
+                simulationConfig.checkpointTime = stoi(string(argv[i + 1]));
+                i += 2;
+            }
+            else break;
+        }
+
+
+        else if (a =="--checkpointLoad")
+        {
+            if (i + 1 < argc)
+            {
+                simulationConfig.checkpointLoadPath = string(argv[i + 1]);
+                i += 2;
+            }
+            else break;
+        }
+
+
+        else if (a =="--batchAllocs")
+        {
+            if (i + 1 < argc)
+            {
+                simulationConfig.batchHeapAllocs = (stoi(string(argv[i + 1])) != 0);
+                i += 2;
+            }
+            else break;
+        }
+
+
+        else if (a =="--jobArenas")
+        {
+            if (i + 1 < argc)
+            {
+                simulationConfig.jobArenas = (stoi(string(argv[i + 1])) != 0);
+                i += 2;
+            }
+            else break;
+        }
+
+
+        else if (a =="--orphanPolicy")
+        {
+            if (i + 1 < argc)
+            {
+                string policy = string(argv[i + 1]);
+
+                if (policy == "free") simulationConfig.orphanHeapPolicy = 0;
+                else if (policy == "keep") simulationConfig.orphanHeapPolicy = 1;
+                else
+                {
+                    cout << "Error: unknown orphan policy " << policy << endl;
+                    return 1;
+                }
+                i += 2;
+            }
+            else break;
+        }
+
+
+        else if (a =="--lifetimeAware")
+        {
+            if (i + 1 < argc)
+            {
+                simulationConfig.lifetimeAware = (stoi(string(argv[i + 1])) != 0);
+                i += 2;
+            }
+            else break;
+        }
+
+
+        else if (a =="--lifetimeThreshold")
+        {
+            if (i + 1 < argc)
+            {
+                simulationConfig.lifetimeThreshold = stoi(string(argv[i + 1]));
+                i += 2;
+            }
+            else break;
+        }
+
+
+        else if (a =="--logFileLifetimeAware")
+        {
+            if (i + 1 < argc)
+            {
+                simulationConfig.logFileLifetimeAware = string(argv[i + 1]);
+                i += 2;
+            }
+            else break;
+        }
+
+
+        else if (a =="--admissionQueue")
+        {
+            if (i + 1 < argc)
+            {
+                simulationConfig.admissionQueue = (stoi(string(argv[i + 1])) != 0);
+                i += 2;
+            }
+            else break;
+        }
+
+
+        else if (a =="--jobModel")
+        {
+            if (i + 1 < argc)
+            {
+                string jobModel = string(argv[i + 1]);
+
+                if (jobModel == "prebuilt") simulationConfig.jobModel = 0;
+                else if (jobModel == "coroutine") simulationConfig.jobModel = 1;
+                else
+                {
+                    cout << "Error: unknown job model " << jobModel << endl;
+                    return 1;
+                }
+                i += 2;
+            }
+            else break;
+        }
+
+
+        else if (a =="--horizon")
+        {
+            if (i + 1 < argc)
+            {
+                simulationConfig.arrivalHorizon = stoi(string(argv[i + 1]));
+                i += 2;
+            }
+            else break;
+        }
+
+
+        else if (a =="--prefill")
+        {
+            if (i + 1 < argc)
+            {
+                simulationConfig.prefillTime = stoi(string(argv[i + 1]));
+                i += 2;
+            }
+            else break;
+        }
+
+
+        else if (a =="--sampleInterval")
+        {
+            if (i + 1 < argc)
+            {
+                simulationConfig.sampleInterval = stoi(string(argv[i + 1]));
+                i += 2;
+            }
+            else break;
+        }
+
+
+        else if (a =="--maxHeapElements")
+        {
+            if (i + 1 < argc)
+            {
+                simulationConfig.maxHeapElements = stoi(string(argv[i + 1]));
+                i += 2;
+            }
+            else break;
+        }
+
+
+        else if (a =="--steadyState")
+        {
+            if (i + 1 < argc)
+            {
+                simulationConfig.steadyState = (stoi(string(argv[i + 1])) != 0);
+                i += 2;
+            }
+            else break;
+        }
+
+
+        else if (a =="--steadyWindow")
+        {
+            if (i + 1 < argc)
+            {
+                simulationConfig.steadyWindow = stoi(string(argv[i + 1]));
+                i += 2;
+            }
+            else break;
+        }
+
+
+        else if (a =="--steadyTolerance")
+        {
+            if (i + 1 < argc)
+            {
+                simulationConfig.steadyTolerance = stod(string(argv[i + 1]));
+                i += 2;
+            }
+            else break;
+        }
+
+
+        else if (a =="--steadyHalfWidth")
+        {
+            if (i + 1 < argc)
+            {
+                simulationConfig.steadyHalfWidth = stod(string(argv[i + 1]));
+                i += 2;
+            }
+            else break;
+        }
+
+
+        else if (a =="--replicas")
+        {
+            if (i + 1 < argc)
+            {
+                replicaCount = stoi(string(argv[i + 1]));
+                i += 2;
+            }
+            else break;
+        }
+
+
+        else if (a =="--threads")
+        {
+            if (i + 1 < argc)
+            {
+                replicaThreads = stoi(string(argv[i + 1]));
+                i += 2;
+            }
+            else break;
+        }
+
+
+        else if (a =="--replicaHalfWidth")
+        {
+            if (i + 1 < argc)
+            {
+                replicaHalfWidth = stod(string(argv[i + 1]));
+                i += 2;
+            }
+            else break;
+        }
+
+
+        else if (a =="--replicaMetric")
+        {
+            if (i + 1 < argc)
+            {
+                replicaMetric = string(argv[i + 1]);
+                i += 2;
+            }
+            else break;
+        }
+
+
+        else if (a =="--maxReplicas")
+        {
+            if (i + 1 < argc)
+            {
+                maxReplicas = stoi(string(argv[i + 1]));
+                i += 2;
+            }
+            else break;
+        }
+
+
+        else if (a =="--timeSeries")
+        {
+            if (i + 1 < argc)
+            {
+                simulationConfig.timeSeriesFilePath = string(argv[i + 1]);
+                i += 2;
+            }
+            else break;
+        }
+
+
+        else if (a =="--decodeTimeSeries")
+        {
+            if (i + 1 < argc)
+            {
+                decodeTimeSeriesPath = string(argv[i + 1]);
+                i += 2;
+            }
+            else break;
+        }
+
+
+        else if (a =="--decodeOutput")
+        {
+            if (i + 1 < argc)
+            {
+                decodeOutputPath = string(argv[i + 1]);
+                i += 2;
+            }
+            else break;
+        }
+
+
+        else if (a =="--freeBlockHistogram")
+        {
+            if (i + 1 < argc)
+            {
+                simulationConfig.freeBlockFilePath = string(argv[i + 1]);
+                i += 2;
+            }
+            else break;
+        }
+
+
+        else if (a =="--usableSize")
+        {
+            if (i + 1 < argc)
+            {
+                simulationConfig.usableRequestBytes = stoi(string(argv[i + 1]));
+                i += 2;
+            }
+            else break;
+        }
+
+
+        else if (a =="--heatmap")
+        {
+            if (i + 1 < argc)
+            {
+                simulationConfig.heatmapFilePrefix = string(argv[i + 1]);
+                i += 2;
+            }
+            else break;
+        }
+
+
+        else if (a =="--heatmapRows")
+        {
+            if (i + 1 < argc)
+            {
+                simulationConfig.heatmapRows = stoi(string(argv[i + 1]));
+                i += 2;
+            }
+            else break;
+        }
+
+
+        else if (a =="--heatmapInterval")
+        {
+            if (i + 1 < argc)
+            {
+                simulationConfig.heatmapInterval = stoi(string(argv[i + 1]));
+                i += 2;
+            }
+            else break;
+        }
+
+
+        else if (a =="--heatmapColumns")
+        {
+            if (i + 1 < argc)
+            {
+                simulationConfig.heatmapMaxColumns = stoi(string(argv[i + 1]));
+                i += 2;
+            }
+            else break;
+        }
+
+
+        else if (a =="--batch")
+        {
+            if (i + 1 < argc)
+            {
+                batchFilePath = string(argv[i + 1]);
+                i += 2;
+            }
+            else break;
+        }
+
+
         //unknown arg, skip
         else i++;
     }
 
     // finished parsing args
 
+    if (!decodeTimeSeriesPath.empty())
+    {
+        if (!TimeSeriesWriter::decodeToCsv(decodeTimeSeriesPath, decodeOutputPath))
+        {
+            cout << "Error: could not decode time series " << decodeTimeSeriesPath << endl;
+            return 1;
+        }
+        return 0;
+    }
+
     // validate percentages for simulation
     int totalPercent = simulationConfig.percentSmall + simulationConfig.percentMedium+ simulationConfig.percentLarge;
 
@@ -234,12 +841,47 @@ int main(int argc, char* argv[])
     generator.configure(generatorConfig);
     generator.generatetimeBetweenArrivalCSV();
 
-    cout<<"Running simulation for test: " << simulationConfig.testName << endl;
+    if (!batchFilePath.empty())
+    {
+        if (replicaCount > 0 || !simulationConfig.checkpointSavePath.empty() || !simulationConfig.checkpointLoadPath.empty())
+        {
+            cout << "Error: --batch cannot be combined with --replicas or checkpoints" << endl;
+            return 1;
+        }
+
+        BatchRunner batch;
+        batch.configure(simulationConfig, replicaThreads);
+        if (!batch.loadFile(batchFilePath)) return 1;
+
+        if (!batch.run()) return 2; //a test failed like a single run would
+        return 0;
+    }
+
+    if (simulationConfig.textReport) cout<<"Running simulation for test: " << simulationConfig.testName << "\n";
+
+    if (replicaCount > 0)
+    {
+        if (!simulationConfig.checkpointSavePath.empty() || !simulationConfig.checkpointLoadPath.empty())
+        {
+            cout << "Error: --replicas cannot be combined with checkpoints" << endl;
+            return 1;
+        }
+
+        ReplicaRunner runner;
+        runner.configure(simulationConfig, replicaCount, replicaThreads);
+        runner.setStopping(replicaHalfWidth, replicaMetric, maxReplicas);
+
+        if (!runner.run()) return runner.failed ? 2 : 1; //2 = a replica failed like a single run would
+        return 0;
+    }
 
     MemorySimulation simulation;
     simulation.configure(simulationConfig);
     simulation.run();
 
+    if (simulation.checkpointFailed) return 1;
+    if (simulation.verifyFailed) return 2; //engines disagreed
+
     return 0;
 }
 
@@ -7,6 +7,18 @@ MemoryAllocator::MemoryAllocator()
 
     nextFitSearchStart = 0;
 
+    algorithmType = 0;
+    engineType = 0;
+    ownershipType = 0;
+    jobArenas = false;
+    lifetimeThreshold = 5;
+    activeRequestedBytes = 0;
+
+    trackFreeBlocks = false;
+    freeBlocksStale = false;
+    freeUnitCount = 0;
+    freeBlockCount = 0;
+
     currentJobId = -1;
 
     allocationCount = 0;
@@ -14,25 +26,57 @@ MemoryAllocator::MemoryAllocator()
     freeRequestCount = 0;
     freeOperationCount = 0;
 
+    clockTime = 0;
+    allocatedUnitTicks = 0;
+    requiredByteTicks = 0;
+    freeBlockTicks = 0;
 }
 
-void MemoryAllocator::configure(int memoryUnitSizeValue, int memoryUnitCountValue, const string &algorithmNameValue)
+void MemoryAllocator::configure(long long memoryUnitSizeValue, long long memoryUnitCountValue, const string &algorithmNameValue)
 {
     memoryUnitSize = memoryUnitSizeValue; //bytes per memory unit
     memoryUnitCount = memoryUnitCountValue; //available count
     algorithmName = algorithmNameValue;
 
-    unitJobId.clear();
-    unitJobId.resize(memoryUnitCount, -1);          //reset
+    if (ownershipType == 1)
+    {
+        unitJobId.release(); //give the memory back, runs only
+        ownerRuns.reset(memoryUnitCount);
+        engineType = 1; //scanners walk unitJobId
+    }
+    else
+    {
+        bool mapped = false;
+        if (ownershipType == 2) mapped = unitJobId.mapFile(unitMapFilePath, memoryUnitCount, engineType == 0);
+
+        if (!mapped) unitJobId.allocate(memoryUnitCount);          //reset, also the fallback if the file cant be mapped
+        ownerRuns.reset(0);
+    }
 
     allocations.clear();
 
+    freeBlocks.reset(memoryUnitCount);
+    freeBlocksStale = false;
+    freeUnitCount = memoryUnitCount;
+    freeBlockCount = (memoryUnitCount > 0) ? 1 : 0;
+    activeRecordByStart.clear();
+    activeRequestedBytes = 0;
+    arenaBlocksByJob.clear();
+
     nextFitSearchStart = 0;
 
     allocationCount = 0;
     allocationOperationCount = 0;
     freeRequestCount = 0;
     freeOperationCount = 0;
+
+    clockTime = 0;
+    allocatedUnitTicks = 0;
+    requiredByteTicks = 0;
+    freeBlockTicks = 0;
+
+    allocationSearchHistogram.reset();
+    freeSearchHistogram.reset();
 }
 
 void MemoryAllocator::setCurrentJobId(int jobIdValue)
@@ -40,139 +84,237 @@ void MemoryAllocator::setCurrentJobId(int jobIdValue)
     currentJobId = jobIdValue;
 }
 
-int MemoryAllocator::mallocFF(int sizeBytes)
+long long MemoryAllocator::mallocFF(long long sizeBytes)
 {
     if (memoryUnitSize <= 0) return -1; //if fail case
 
 
     //how many memory units to hold sizeBytes and round up
-    int requiredUnits = (sizeBytes + memoryUnitSize - 1) / memoryUnitSize;
-    int location = allocateFirstFit(requiredUnits); //find space of free
-
-    if (location >= 0) //if space found, continue
-    {
-        AllocationRecord record;
-        record.startIndex = location;
-        record.unitCount = requiredUnits; //how many reserved
-        record.requestedBytes = sizeBytes;
-        record.jobId = currentJobId;
-        record.isActive = true;
+    long long requiredUnits = (sizeBytes + memoryUnitSize - 1) / memoryUnitSize;
+    long long operationsBefore = allocationOperationCount;
+    long long location = allocateFirstFit(requiredUnits); //find space of free
+    allocationSearchHistogram.record(allocationOperationCount - operationsBefore); //units examined this call
 
-        allocations.push_back(record);
-        allocationCount++;        //save and iterate
-    }
+    if (location >= 0) addAllocationRecord(location, requiredUnits, sizeBytes); //if space found, save and iterate
 
 
     return location;
 }
 
 
-int MemoryAllocator::mallocNF(int sizeBytes)
+long long MemoryAllocator::mallocNF(long long sizeBytes)
 {
     if (memoryUnitSize <= 0) return -1;  //same process as above
 
 
-    int requiredUnits = (sizeBytes + memoryUnitSize - 1) / memoryUnitSize;
-    int location = allocateNextFit(requiredUnits);
+    long long requiredUnits = (sizeBytes + memoryUnitSize - 1) / memoryUnitSize;
+    long long operationsBefore = allocationOperationCount;
+    long long location = allocateNextFit(requiredUnits);
+    allocationSearchHistogram.record(allocationOperationCount - operationsBefore);
 
-    if (location >= 0)
-    {
-        AllocationRecord record;
-        record.startIndex = location;
-        record.unitCount = requiredUnits;
-        record.requestedBytes = sizeBytes;
-        record.jobId = currentJobId;
-        record.isActive = true;
+    if (location >= 0) addAllocationRecord(location, requiredUnits, sizeBytes);
 
-        allocations.push_back(record);
-        allocationCount++;
-    }
 
+    return location;
+}
+
+long long MemoryAllocator::mallocBF(long long sizeBytes)
+{
+    if (memoryUnitSize <= 0) return -1;
+
+
+    long long requiredUnits = (sizeBytes + memoryUnitSize - 1) / memoryUnitSize;
+    long long operationsBefore = allocationOperationCount;
+    long long location = allocateBestFit(requiredUnits);
+    allocationSearchHistogram.record(allocationOperationCount - operationsBefore);
+
+    if (location >= 0) addAllocationRecord(location, requiredUnits, sizeBytes);
 
     return location;
 }
 
-int MemoryAllocator::mallocBF(int sizeBytes)
+long long MemoryAllocator::mallocWF(long long sizeBytes)
 {
     if (memoryUnitSize <= 0) return -1;
 
+    long long requiredUnits = (sizeBytes + memoryUnitSize - 1) / memoryUnitSize;
+    long long operationsBefore = allocationOperationCount;
+    long long location = allocateWorstFit(requiredUnits);
+    allocationSearchHistogram.record(allocationOperationCount - operationsBefore);
 
-    int requiredUnits = (sizeBytes + memoryUnitSize - 1) / memoryUnitSize;
-    int location = allocateBestFit(requiredUnits);
+    if (location >= 0) addAllocationRecord(location, requiredUnits, sizeBytes);
 
-    if (location >= 0)
-    {
-        AllocationRecord record;
-        record.startIndex = location;
-        record.unitCount = requiredUnits;
-        record.requestedBytes = sizeBytes;
-        record.jobId = currentJobId;
-        record.isActive = true;
 
-        allocations.push_back(record);
-        allocationCount++;
-    }
 
     return location;
 }
 
-int MemoryAllocator::mallocWF(int sizeBytes)
+void MemoryAllocator::addAllocationRecord(long long location, long long requiredUnits, long long sizeBytes)
+{
+    AllocationRecord record;
+    record.startIndex = location;
+    record.unitCount = requiredUnits; //how many reserved
+    record.requestedBytes = sizeBytes;
+    record.jobId = currentJobId;
+    record.isActive = true;
+
+    activeRecordByStart[location] = (long long)allocations.size();
+    activeRequestedBytes += sizeBytes;
+    if (jobArenas) arenaBlocksByJob[currentJobId].insert(location);
+
+    allocations.push_back(record);
+    allocationCount++;
+}
+
+long long MemoryAllocator::mallocLA(long long sizeBytes, int lifetimeHint)
 {
     if (memoryUnitSize <= 0) return -1;
 
-    int requiredUnits = (sizeBytes + memoryUnitSize - 1) / memoryUnitSize;
-    int location = allocateWorstFit(requiredUnits);
+    long long requiredUnits = (sizeBytes + memoryUnitSize - 1) / memoryUnitSize;
+    long long operationsBefore = allocationOperationCount;
+    long long location = allocateLifetimeAware(requiredUnits, lifetimeHint);
+    allocationSearchHistogram.record(allocationOperationCount - operationsBefore);
 
-    if (location >= 0)
-    {
-        AllocationRecord record;
-        record.startIndex = location;
-        record.unitCount = requiredUnits;
-        record.requestedBytes = sizeBytes;
-        record.jobId = currentJobId;
-        record.isActive = true;
-        allocations.push_back(record);
-        allocationCount++;
-    }
+    if (location >= 0) addAllocationRecord(location, requiredUnits, sizeBytes);
 
+    return location;
+}
 
+long long MemoryAllocator::mallocByType(long long sizeBytes, int lifetimeHint)
+{
+    if (algorithmType == 1) return mallocNF(sizeBytes);
+    if (algorithmType == 2) return mallocBF(sizeBytes);
+    if (algorithmType == 3) return mallocWF(sizeBytes);
+    if (algorithmType == 4) return mallocLA(sizeBytes, lifetimeHint);
 
-    return location;
+    return mallocFF(sizeBytes); //0 or unknown
 }
 
-void MemoryAllocator::freeFF(int startIndex)
+void MemoryAllocator::freeFF(long long startIndex)
 {
     if (startIndex < 0) return; //bad start, end
 
 
     freeRequestCount++;
 
-    int count = (int)allocations.size();
+    long long operationsBefore = freeOperationCount;
+    long long count = (long long)allocations.size();
 
+    long long found = -1;
 
-    for (int i = 0; i < count; i++)
+    if (engineType == 1)
     {
-        freeOperationCount++;    //alloc record
+        // indexed, jump to the record but count it like the scan would (index + 1)
+        map<long long, long long>::iterator it = activeRecordByStart.find(startIndex);
 
-        AllocationRecord &record = allocations[i];
+        if (it != activeRecordByStart.end())
+        {
+            found = it->second;
+            freeOperationCount += found + 1;
+        }
+        else freeOperationCount += count;
+    }
+
+    else
+    {
+        for (long long i = 0; i < count; i++)
+        {
+            freeOperationCount++;    //alloc record
+
+            AllocationRecord &record = allocations[i];
+
+            // look for active allocation at this index
+            if (record.isActive && record.startIndex == startIndex)
+            {
+                found = i;
+                break;
+            }
+        }
+    }
+
+    if (found >= 0) releaseRecord(found);
+
+    freeSearchHistogram.record(freeOperationCount - operationsBefore);
+}
+
+
+void MemoryAllocator::cancelAllocation(long long startIndex, long long nextFitStart)
+{
+    map<long long, long long>::iterator it = activeRecordByStart.find(startIndex);
+    if (it == activeRecordByStart.end()) return;
+
+    long long recordIndex = it->second;
+    releaseRecord(recordIndex);
+
+    if (recordIndex == (long long)allocations.size() - 1) allocations.pop_back(); //freeFF would walk past it otherwise
+    allocationCount--;
+    nextFitSearchStart = nextFitStart;
+}
+
+
+void MemoryAllocator::releaseRecord(long long recordIndex)
+{
+    AllocationRecord &record = allocations[recordIndex];
+
+    // mark units free in unitJobId array
+    markUnitsFree(record.startIndex, record.unitCount);
+    record.isActive = false;
+
+    activeRecordByStart.erase(record.startIndex);
+    activeRequestedBytes -= record.requestedBytes;
 
-        // look for active allocation at this index
-        if (record.isActive && record.startIndex == startIndex)
+    if (jobArenas)
+    {
+        map<int, set<long long>>::iterator arena = arenaBlocksByJob.find(record.jobId);
+        if (arena != arenaBlocksByJob.end())
         {
-            // mark units free in unitJobId array
-            markUnitsFree(record.startIndex, record.unitCount);
-            record.isActive = false;
-            break;
+            arena->second.erase(record.startIndex);
+            if (arena->second.empty()) arenaBlocksByJob.erase(arena);
         }
     }
 }
 
-int MemoryAllocator::allocateFirstFit(int requiredUnits)
+
+// job arenas -------------------------------------------------------------
+// every active block of a job goes in one free request, no record search,
+// one operation per block released. keepStarts stay allocated (and in the
+// arena) until their own freeFF
+void MemoryAllocator::freeJobArena(int jobId, const vector<long long> &keepStarts, vector<long long> &releasedStarts)
 {
-    int start = -1; //free num
-    int length = 0;
+    releasedStarts.clear();
+    freeRequestCount++;
+
+    long long operationsBefore = freeOperationCount;
+
+    map<int, set<long long>>::iterator arena = arenaBlocksByJob.find(jobId);
+    if (arena != arenaBlocksByJob.end())
+    {
+        set<long long> keep(keepStarts.begin(), keepStarts.end());
+
+        for (set<long long>::iterator it = arena->second.begin(); it != arena->second.end(); ++it)
+        {
+            if (keep.count(*it) == 0) releasedStarts.push_back(*it);
+        }
+
+        // arena iterator is gone once its last block is released
+        for (size_t i = 0; i < releasedStarts.size(); i++)
+        {
+            freeOperationCount++;
+            releaseRecord(activeRecordByStart[releasedStarts[i]]);
+        }
+    }
+
+    freeSearchHistogram.record(freeOperationCount - operationsBefore);
+}
+
+long long MemoryAllocator::allocateFirstFit(long long requiredUnits)
+{
+    if (engineType == 1) return allocateFirstFitIndexed(requiredUnits);
+
+    long long start = -1; //free num
+    long long length = 0;
 
-    for (int i = 0; i<memoryUnitCount; i++) //from 0 to find first space
+    for (long long i = 0; i<memoryUnitCount; i++) //from 0 to find first space
     {
         allocationOperationCount++;
 
@@ -199,17 +341,19 @@ int MemoryAllocator::allocateFirstFit(int requiredUnits)
     return -1; //spaces too small, failed
 }
 
-int MemoryAllocator::allocateNextFit(int requiredUnits)
+long long MemoryAllocator::allocateNextFit(long long requiredUnits)
 {
-    int examined = 0; //units checked
-    int index = nextFitSearchStart; //start from last position
+    if (engineType == 1) return allocateNextFitIndexed(requiredUnits);
 
-    int start = -1;
-    int length = 0;
+    long long examined = 0; //units checked
+    long long index = nextFitSearchStart; //start from last position
+
+    long long start = -1;
+    long long length = 0;
 
     while (examined < memoryUnitCount) //keep scanning til every unit examined
     {
-        int realIndex = index % memoryUnitCount; //wrap around
+        long long realIndex = index % memoryUnitCount; //wrap around
         allocationOperationCount++;
 
         if (unitJobId[realIndex] == -1) //free unit
@@ -241,15 +385,17 @@ int MemoryAllocator::allocateNextFit(int requiredUnits)
     return -1;
 }
 
-int MemoryAllocator::allocateBestFit(int requiredUnits)
+long long MemoryAllocator::allocateBestFit(long long requiredUnits)
 {
-    int bestStart = -1;
-    int bestLength = memoryUnitCount + 1;
+    if (engineType == 1) return allocateBestFitIndexed(requiredUnits);
+
+    long long bestStart = -1;
+    long long bestLength = memoryUnitCount + 1;
 
-    int start = -1;
-    int length = 0;
+    long long start = -1;
+    long long length = 0;
 
-    for (int i = 0; i < memoryUnitCount; i++)
+    for (long long i = 0; i < memoryUnitCount; i++)
     {
         allocationOperationCount++;
 
@@ -285,15 +431,17 @@ int MemoryAllocator::allocateBestFit(int requiredUnits)
 }
 
 
-int MemoryAllocator::allocateWorstFit(int requiredUnits)
+long long MemoryAllocator::allocateWorstFit(long long requiredUnits)
 {
-    int worstStart = -1;
-    int worstLength = -1;
+    if (engineType == 1) return allocateWorstFitIndexed(requiredUnits);
+
+    long long worstStart = -1;
+    long long worstLength = -1;
 
-    int start = -1;
-    int length = 0;
+    long long start = -1;
+    long long length = 0;
 
-    for (int i = 0; i < memoryUnitCount; i++)
+    for (long long i = 0; i < memoryUnitCount; i++)
     {
         allocationOperationCount++;
 
@@ -323,38 +471,292 @@ int MemoryAllocator::allocateWorstFit(int requiredUnits)
 }
 
 
-void MemoryAllocator::markUnitsAllocated(int startIndex, int unitCount)
+// lifetime aware: short lived blocks first fit from the bottom, long lived
+// ones packed down from the top, so churn stays away from long lived blocks
+bool MemoryAllocator::isShortLived(int lifetimeHint)
+{
+    return lifetimeHint < 0 || lifetimeHint <= lifetimeThreshold;
+}
+
+long long MemoryAllocator::allocateLifetimeAware(long long requiredUnits, int lifetimeHint)
+{
+    if (isShortLived(lifetimeHint)) return allocateFirstFit(requiredUnits);
+    return allocateHighFit(requiredUnits);
+}
+
+long long MemoryAllocator::allocateHighFit(long long requiredUnits)
+{
+    if (engineType == 1) return allocateHighFitIndexed(requiredUnits);
+
+    long long length = 0;
+
+    for (long long i = memoryUnitCount - 1; i >= 0; i--) //from the top down
+    {
+        allocationOperationCount++;
+
+        if (unitJobId[i] == -1)
+        {
+            length++;
+
+            if (length >= requiredUnits) //top end of this free block
+            {
+                markUnitsAllocated(i, requiredUnits);
+                return i;
+            }
+        }
+
+        else length = 0;
+    }
+
+    return -1;
+}
+
+
+void MemoryAllocator::markUnitsAllocated(long long startIndex, long long unitCount)
 {
-    int end = startIndex + unitCount;
+    long long end = startIndex + unitCount;
 
     if (end > memoryUnitCount) end = memoryUnitCount; //end cannot exceed, bound
 
-    for (int i = startIndex; i < end; i++) unitJobId[i] = currentJobId; // mark each as free again
+    if (!keepsFreeBlocks() && end > startIndex)
+    {
+        // range sits inside one free block: it splits in two, shrinks or goes
+        bool freeBefore = startIndex > 0 && unitJobId[startIndex - 1] == -1;
+        bool freeAfter = end < memoryUnitCount && unitJobId[end] == -1;
+        if (freeBefore && freeAfter) freeBlockCount++;
+        else if (!freeBefore && !freeAfter) freeBlockCount--;
+
+        freeUnitCount -= end - startIndex;
+        freeBlocksStale = true;
+    }
+
+    if (ownershipType == 1) ownerRuns.assign(startIndex, end - startIndex, currentJobId);
+    else for (long long i = startIndex; i < end; i++) unitJobId[i] = currentJobId; // mark each as free again
+
+    if (keepsFreeBlocks()) freeBlocks.allocate(startIndex, end - startIndex);
 
 }
 
-void MemoryAllocator::markUnitsFree(int startIndex, int unitCount)
+void MemoryAllocator::markUnitsFree(long long startIndex, long long unitCount)
 {
-    int end = startIndex + unitCount;
+    long long end = startIndex + unitCount;
 
     if (end > memoryUnitCount) end = memoryUnitCount;
 
-    for (int i = startIndex; i < end; i++) unitJobId[i] = -1; //set free
+    if (!keepsFreeBlocks() && end > startIndex)
+    {
+        // range was one allocated record: merges with free neighbours or stands alone
+        bool freeBefore = startIndex > 0 && unitJobId[startIndex - 1] == -1;
+        bool freeAfter = end < memoryUnitCount && unitJobId[end] == -1;
+        if (freeBefore && freeAfter) freeBlockCount--;
+        else if (!freeBefore && !freeAfter) freeBlockCount++;
+
+        freeUnitCount += end - startIndex;
+        freeBlocksStale = true;
+    }
+
+    if (ownershipType == 1) ownerRuns.release(startIndex, end - startIndex);
+    else for (long long i = startIndex; i < end; i++) unitJobId[i] = -1; //set free
+
+    if (keepsFreeBlocks()) freeBlocks.release(startIndex, end - startIndex);
+
+}
+
+
+bool MemoryAllocator::keepsFreeBlocks()
+{
+    return engineType == 1 || trackFreeBlocks;
+}
+
+
+// one sweep of unitJobId, only when something changed since the last one
+FreeBlockIndex &MemoryAllocator::getFreeBlocks()
+{
+    if (keepsFreeBlocks() || !freeBlocksStale) return freeBlocks;
+
+    freeBlocks.reset(0);
+    long long i = 0;
+    while (i < memoryUnitCount)
+    {
+        if (unitJobId[i] != -1)
+        {
+            i++;
+            continue;
+        }
+
+        long long start = i;
+        while (i < memoryUnitCount && unitJobId[i] == -1) i++;
+        freeBlocks.insertBlock(start, i - start);
+    }
+
+    freeBlocksStale = false;
+    return freeBlocks;
+}
+
+
+int MemoryAllocator::getUnitJobId(long long unitIndex)
+{
+    if (unitIndex < 0 || unitIndex >= memoryUnitCount) return -1;
+    if (ownershipType == 1) return ownerRuns.getJobId(unitIndex);
+    return unitJobId[unitIndex];
+}
+
+
+void MemoryAllocator::saveState(BinaryWriter &out)
+{
+    out.writeInt(memoryUnitSize);
+    out.writeInt(memoryUnitCount);
+    out.writeInt(algorithmType);
+    out.writeInt(nextFitSearchStart);
+    out.writeInt(currentJobId);
+
+    out.writeInt(allocationCount);
+    out.writeInt(allocationOperationCount);
+    out.writeInt(freeRequestCount);
+    out.writeInt(freeOperationCount);
+
+    out.writeInt((long long)allocations.size()); //inactive ones too, freeFF counts them
+    for (size_t i = 0; i < allocations.size(); i++)
+    {
+        const AllocationRecord &record = allocations[i];
+        out.writeInt(record.startIndex);
+        out.writeInt(record.unitCount);
+        out.writeInt(record.requestedBytes);
+        out.writeInt(record.jobId);
+        out.writeInt(record.isActive ? 1 : 0);
+    }
+
+    // owned runs, start length jobId
+    vector<long long> runs;
+    if (ownershipType == 1)
+    {
+        for (map<long long, OwnedRun>::iterator it = ownerRuns.runs.begin(); it != ownerRuns.runs.end(); ++it)
+        {
+            runs.push_back(it->first);
+            runs.push_back(it->second.length);
+            runs.push_back(it->second.jobId);
+        }
+    }
+    else
+    {
+        long long i = 0;
+        while (i < memoryUnitCount)
+        {
+            int owner = unitJobId[i];
+            long long start = i;
+            while (i < memoryUnitCount && unitJobId[i] == owner) i++;
+
+            if (owner == -1) continue;
+            runs.push_back(start);
+            runs.push_back(i - start);
+            runs.push_back(owner);
+        }
+    }
+    out.writeIntVector(runs);
+
+    allocationSearchHistogram.saveState(out);
+    freeSearchHistogram.saveState(out);
+
+    out.writeInt(clockTime);
+    out.writeInt(allocatedUnitTicks);
+    out.writeInt(requiredByteTicks);
+    out.writeInt(freeBlockTicks);
+}
+
+
+bool MemoryAllocator::loadState(BinaryReader &in)
+{
+    long long unitSize = in.readInt();
+    long long unitCount = in.readInt();
+    if (!in.ok || unitSize != memoryUnitSize || unitCount != memoryUnitCount) return false; //configure first
+
+    algorithmType = (int)in.readInt();
+    nextFitSearchStart = in.readInt();
+    currentJobId = (int)in.readInt();
+
+    allocationCount = in.readInt();
+    allocationOperationCount = in.readInt();
+    freeRequestCount = in.readInt();
+    freeOperationCount = in.readInt();
+
+    long long recordCount = in.readInt();
+    if (!in.ok || recordCount < 0) return false;
+
+    allocations.clear();
+    activeRecordByStart.clear();
+    activeRequestedBytes = 0;
+    for (long long i = 0; i < recordCount && in.ok; i++)
+    {
+        AllocationRecord record;
+        record.startIndex = in.readInt();
+        record.unitCount = in.readInt();
+        record.requestedBytes = in.readInt();
+        record.jobId = (int)in.readInt();
+        record.isActive = (in.readInt() != 0);
+
+        if (record.isActive)
+        {
+            activeRecordByStart[record.startIndex] = i;
+            activeRequestedBytes += record.requestedBytes;
+            if (jobArenas) arenaBlocksByJob[record.jobId].insert(record.startIndex);
+        }
+        allocations.push_back(record);
+    }
+
+    vector<long long> runs = in.readIntVector();
+    if (!in.ok || runs.size() % 3 != 0) return false;
+
+    int savedJobId = currentJobId;
+    for (size_t r = 0; r < runs.size(); r += 3)
+    {
+        long long start = runs[r];
+        long long length = runs[r + 1];
+        if (start < 0 || length <= 0 || start + length > memoryUnitCount) return false;
+
+        currentJobId = (int)runs[r + 2];
+        markUnitsAllocated(start, length); //also carves the free block index
+    }
+    currentJobId = savedJobId;
+
+    if (!allocationSearchHistogram.loadState(in)) return false;
+    if (!freeSearchHistogram.loadState(in)) return false;
 
+    clockTime = in.readInt();
+    allocatedUnitTicks = in.readInt();
+    requiredByteTicks = in.readInt();
+    freeBlockTicks = in.readInt();
+    return in.ok;
 }
 
 
-int MemoryAllocator::getTotalMemorySize()
+void MemoryAllocator::advanceClock(long long time)
+{
+    long long ticks = time - clockTime;
+    if (ticks <= 0) return;
+
+    long long freeUnits = keepsFreeBlocks() ? freeBlocks.getFreeUnits() : freeUnitCount;
+    long long blockCount = keepsFreeBlocks() ? freeBlocks.getBlockCount() : freeBlockCount;
+
+    allocatedUnitTicks += (memoryUnitCount - freeUnits) * ticks;
+    requiredByteTicks += activeRequestedBytes * ticks;
+    freeBlockTicks += blockCount * ticks;
+    clockTime = time;
+}
+
+
+long long MemoryAllocator::getTotalMemorySize()
 {
     return memoryUnitCount * memoryUnitSize; //num units * bytes per unit
 }
 
 
-int MemoryAllocator::getAllocatedMemorySize()
+long long MemoryAllocator::getAllocatedMemorySize()
 {
-    int usedUnits = 0;
+    if (engineType == 1) return (memoryUnitCount - freeBlocks.getFreeUnits()) * memoryUnitSize;
+
+    long long usedUnits = 0;
 
-    for (int i = 0; i < memoryUnitCount; i++) //units in use count
+    for (long long i = 0; i < memoryUnitCount; i++) //units in use count
     {
         if (unitJobId[i] != -1) usedUnits++;
     }
@@ -362,21 +764,25 @@ int MemoryAllocator::getAllocatedMemorySize()
     return usedUnits * memoryUnitSize; //conv to bytes
 }
 
-int MemoryAllocator::getFreeMemorySize()
+long long MemoryAllocator::getFreeMemorySize()
 {
-    int freeUnits = 0;
+    if (engineType == 1) return freeBlocks.getFreeUnits() * memoryUnitSize;
 
-    for (int i = 0; i < memoryUnitCount; i++) if (unitJobId[i] == -1) freeUnits++;
+    long long freeUnits = 0;
+
+    for (long long i = 0; i < memoryUnitCount; i++) if (unitJobId[i] == -1) freeUnits++;
 
     return freeUnits * memoryUnitSize;
 }
 
-int MemoryAllocator::getRequiredMemorySize()
+long long MemoryAllocator::getRequiredMemorySize()
 {
-    int total = 0;
-    int count = (int)allocations.size();
+    if (engineType == 1) return activeRequestedBytes;
+
+    long long total = 0;
+    long long count = (long long)allocations.size();
 
-    for (int i = 0; i < count; i++) //add requested sizes of all active alloc's
+    for (long long i = 0; i < count; i++) //add requested sizes of all active alloc's
     {
         const AllocationRecord &record = allocations[i];
 
@@ -387,12 +793,14 @@ int MemoryAllocator::getRequiredMemorySize()
 }
 
 
-int MemoryAllocator::getExternalFragmentationCount()
+long long MemoryAllocator::getExternalFragmentationCount()
 { //get how many free blocks exist separately
-    int count = 0;
+    if (engineType == 1) return freeBlocks.getBlockCount();
+
+    long long count = 0;
     bool inFreeBlock = false;
 
-    for (int i = 0; i < memoryUnitCount; i++)
+    for (long long i = 0; i < memoryUnitCount; i++)
     {
         if (unitJobId[i] == -1)
         {
@@ -409,12 +817,14 @@ int MemoryAllocator::getExternalFragmentationCount()
     return count;
 }
 
-int MemoryAllocator::getLargestFreeBlockSize()
+long long MemoryAllocator::getLargestFreeBlockSize()
 {
-    int maxLength = 0; // for max store
-    int length = 0; //for current
+    if (engineType == 1) return freeBlocks.getLargestBlock() * memoryUnitSize;
+
+    long long maxLength = 0; // for max store
+    long long length = 0; //for current
 
-    for (int i = 0; i < memoryUnitCount; i++)
+    for (long long i = 0; i < memoryUnitCount; i++)
     {
         if (unitJobId[i] == -1) length++;
 
@@ -432,12 +842,14 @@ int MemoryAllocator::getLargestFreeBlockSize()
     return maxLength * memoryUnitSize;
 }
 
-int MemoryAllocator::getSmallestFreeBlockSize()
+long long MemoryAllocator::getSmallestFreeBlockSize()
 {
-    int minLength = 0;
-    int length = 0;
+    if (engineType == 1) return freeBlocks.getSmallestBlock() * memoryUnitSize;
+
+    long long minLength = 0;
+    long long length = 0;
 
-    for (int i = 0; i < memoryUnitCount; i++)
+    for (long long i = 0; i < memoryUnitCount; i++)
     {
         if (unitJobId[i] == -1) length++;
 
@@ -460,11 +872,329 @@ int MemoryAllocator::getSmallestFreeBlockSize()
 }
 
 
+// indexed engine ---------------------------------------------------------
+// each search walks the free block index instead of every unit, then adds
+// to allocationOperationCount what the scanner would have examined so the
+// counts (and the reports built on them) stay identical
+
+
+long long MemoryAllocator::findFirstFit(FreeBlockIndex &blocks, long long requiredUnits)
+{
+    // first block in address order thats big enough, scanner stops at start + required
+    map<long long, long long>::iterator it;
+    for (it = blocks.blocksByStart.begin(); it != blocks.blocksByStart.end(); ++it)
+    {
+        if (it->second >= requiredUnits)
+        {
+            long long start = it->first;
+            allocationOperationCount += start + requiredUnits;
+            return start;
+        }
+    }
+
+    allocationOperationCount += memoryUnitCount; //scanned everything
+    return -1;
+}
+
+
+long long MemoryAllocator::findNextFit(FreeBlockIndex &freeIndex, long long requiredUnits)
+{
+    // the scanner walks units s..end then 0..s-1 (s = nextFitSearchStart) without
+    // resetting its run at the wrap, so a free block ending at the last unit
+    // joins the block at unit 0. work in scan distance d = (index - s) mod count
+    // and merge segments that touch, same runs the scanner sees
+
+    if (memoryUnitCount <= 0) return -1;
+
+    long long s = nextFitSearchStart;
+    map<long long, long long> &blocks = freeIndex.blocksByStart;
+
+    long long runStart = -1; //scan distance where current run starts
+    long long runLength = 0;
+    long long foundAt = -1;
+
+    // feed one free segment in scan order, true once a run is big enough
+    auto consider = [&](long long segmentStart, long long segmentLength)
+    {
+        if (runLength > 0 && runStart + runLength == segmentStart) runLength += segmentLength; //touching at the wrap
+        else
+        {
+            runStart = segmentStart;
+            runLength = segmentLength;
+        }
+
+        if (runLength >= requiredUnits) foundAt = runStart;
+        return foundAt >= 0;
+    };
+
+    map<long long, long long>::iterator after = blocks.upper_bound(s);
+
+    long long tailStart = -1; //part of the block holding s thats before s, scanned last
+    long long tailLength = 0;
+
+    bool found = false;
+
+    // block holding s, from s to its end
+    if (after != blocks.begin())
+    {
+        map<long long, long long>::iterator holding = after;
+        --holding;
+        long long holdingEnd = holding->first + holding->second;
+
+        if (holdingEnd > s)
+        {
+            found = consider(0, holdingEnd - s);
+            tailStart = holding->first;
+            tailLength = s - holding->first;
+        }
+    }
+
+    // blocks after s
+    for (map<long long, long long>::iterator it = after; !found && it != blocks.end(); ++it)
+    {
+        found = consider(it->first - s, it->second);
+    }
+
+    // wrap, blocks from unit 0 up to s (block holding s comes last as the tail)
+    for (map<long long, long long>::iterator it = blocks.begin(); !found && it != blocks.end(); ++it)
+    {
+        if (it->first >= s) break;
+        if (tailLength > 0 && it->first == tailStart) break;
+
+        found = consider(it->first - s + memoryUnitCount, it->second);
+    }
+
+    if (!found && tailLength > 0) found = consider(tailStart - s + memoryUnitCount, tailLength);
+
+    if (!found)
+    {
+        allocationOperationCount += memoryUnitCount;
+        return -1;
+    }
+
+    allocationOperationCount += foundAt + requiredUnits;
+
+    return (foundAt + s) % memoryUnitCount;
+}
+
+
+long long MemoryAllocator::findBestFit(FreeBlockIndex &blocks, long long requiredUnits)
+{
+    allocationOperationCount += memoryUnitCount; //scanner always walks everything
+
+    // smallest block thats big enough, lowest address on ties (scanner uses <)
+    set<pair<long long, long long>>::iterator it = blocks.blocksBySize.lower_bound(make_pair(requiredUnits, -1));
+    if (it == blocks.blocksBySize.end()) return -1;
+
+    return it->second;
+}
+
+
+long long MemoryAllocator::findWorstFit(FreeBlockIndex &blocks, long long requiredUnits)
+{
+    allocationOperationCount += memoryUnitCount;
+
+    if (blocks.blocksBySize.empty()) return -1;
+
+    // largest block, lowest address on ties (scanner uses >)
+    long long largest = blocks.blocksBySize.rbegin()->first;
+    if (largest < requiredUnits) return -1;
+
+    return blocks.blocksBySize.lower_bound(make_pair(largest, -1))->second;
+}
+
+
+long long MemoryAllocator::findHighFit(FreeBlockIndex &blocks, long long requiredUnits)
+{
+    // highest block thats big enough, scanner walks down from the top to its upper end - required
+    map<long long, long long>::reverse_iterator it;
+    for (it = blocks.blocksByStart.rbegin(); it != blocks.blocksByStart.rend(); ++it)
+    {
+        if (it->second >= requiredUnits)
+        {
+            long long start = it->first + it->second - requiredUnits;
+            allocationOperationCount += memoryUnitCount - start;
+            return start;
+        }
+    }
+
+    allocationOperationCount += memoryUnitCount;
+    return -1;
+}
+
+
+// the find* searches only count operations, these place the block
+long long MemoryAllocator::allocateFirstFitIndexed(long long requiredUnits)
+{
+    long long start = findFirstFit(freeBlocks, requiredUnits);
+    if (start >= 0) markUnitsAllocated(start, requiredUnits);
+    return start;
+}
+
+
+long long MemoryAllocator::allocateNextFitIndexed(long long requiredUnits)
+{
+    long long start = findNextFit(freeBlocks, requiredUnits);
+    if (start < 0) return -1;
+
+    markUnitsAllocated(start, requiredUnits); //clamps at the end like the scanner
+    nextFitSearchStart = (start + requiredUnits) % memoryUnitCount;
+    return start;
+}
+
+
+long long MemoryAllocator::allocateBestFitIndexed(long long requiredUnits)
+{
+    long long start = findBestFit(freeBlocks, requiredUnits);
+    if (start >= 0) markUnitsAllocated(start, requiredUnits);
+    return start;
+}
+
+
+long long MemoryAllocator::allocateWorstFitIndexed(long long requiredUnits)
+{
+    long long start = findWorstFit(freeBlocks, requiredUnits);
+    if (start >= 0) markUnitsAllocated(start, requiredUnits);
+    return start;
+}
+
+
+long long MemoryAllocator::allocateHighFitIndexed(long long requiredUnits)
+{
+    long long start = findHighFit(freeBlocks, requiredUnits);
+    if (start >= 0) markUnitsAllocated(start, requiredUnits);
+    return start;
+}
+
+
+// batch ------------------------------------------------------------------
+// all requests of one tick in order, same placements, counts and records as
+// calling mallocByType for each. sequential first fit puts a request in the
+// lowest free run that still holds it once the requests before it are in,
+// so walking the runs once in address order and filling each from its low
+// end with the waiting requests that fit, in request order, lands every
+// request on the same unit: one pass for the whole tick. next fit already
+// starts each search where the last one placed, best and worst fit need
+// every run per request and LA with long lived requests fills from both
+// ends, so those still go one request at a time
+void MemoryAllocator::mallocBatch(const vector<long long> &sizes, const vector<int> &jobIds, const vector<int> &lifetimeHints, vector<long long> &locations)
+{
+    locations.assign(sizes.size(), -1);
+    if (memoryUnitSize <= 0 || sizes.empty()) return;
+
+    bool firstFit = (algorithmType == 0);
+    if (algorithmType == 4) //LA with only short lived requests is first fit
+    {
+        firstFit = true;
+        for (size_t r = 0; r < sizes.size(); r++)
+        {
+            if (!isShortLived((r < lifetimeHints.size()) ? lifetimeHints[r] : -1)) firstFit = false;
+        }
+    }
+
+    if (!firstFit)
+    {
+        for (size_t r = 0; r < sizes.size(); r++)
+        {
+            currentJobId = jobIds[r];
+            locations[r] = mallocByType(sizes[r], (r < lifetimeHints.size()) ? lifetimeHints[r] : -1);
+        }
+        return;
+    }
+
+    vector<long long> requiredUnits(sizes.size());
+    vector<size_t> waiting; //not placed yet, request order
+    long long smallestWaiting = memoryUnitCount + 1; //runs shorter than this are passed over
+    for (size_t r = 0; r < sizes.size(); r++)
+    {
+        requiredUnits[r] = (sizes[r] + memoryUnitSize - 1) / memoryUnitSize;
+        waiting.push_back(r);
+        if (requiredUnits[r] < smallestWaiting) smallestWaiting = requiredUnits[r];
+    }
+
+    if (engineType == 1)
+    {
+        map<long long, long long>::iterator it = freeBlocks.blocksByStart.begin();
+        while (!waiting.empty() && it != freeBlocks.blocksByStart.end())
+        {
+            long long start = it->first;
+            long long length = it->second;
+
+            fillFreeRun(start, length, requiredUnits, jobIds, waiting, smallestWaiting, locations);
+            it = freeBlocks.blocksByStart.lower_bound(start + length); //filling may have split or erased this block
+        }
+    }
+    else
+    {
+        long long i = 0;
+        while (!waiting.empty() && i < memoryUnitCount)
+        {
+            if (unitJobId[i] != -1)
+            {
+                i++;
+                continue;
+            }
+
+            long long start = i;
+            while (i < memoryUnitCount && unitJobId[i] == -1) i++;
+
+            fillFreeRun(start, i - start, requiredUnits, jobIds, waiting, smallestWaiting, locations);
+        }
+    }
+
+    // what each sequential search would have counted, then the records in request order
+    for (size_t r = 0; r < sizes.size(); r++)
+    {
+        long long operations = (locations[r] >= 0) ? locations[r] + requiredUnits[r] : memoryUnitCount;
+        allocationOperationCount += operations;
+        allocationSearchHistogram.record(operations);
+
+        currentJobId = jobIds[r];
+        if (locations[r] >= 0) addAllocationRecord(locations[r], requiredUnits[r], sizes[r]);
+    }
+}
+
+
+// one free run of the first fit batch: waiting requests that still fit go in
+// from its low end, in request order, the rest keep waiting
+void MemoryAllocator::fillFreeRun(long long runStart, long long runLength, const vector<long long> &requiredUnits, const vector<int> &jobIds, vector<size_t> &waiting, long long &smallestWaiting, vector<long long> &locations)
+{
+    if (runLength < smallestWaiting) return; //nothing waiting fits, dont walk the list
+
+    long long used = 0;
+    size_t kept = 0;
+    smallestWaiting = memoryUnitCount + 1;
+
+    for (size_t w = 0; w < waiting.size(); w++)
+    {
+        size_t r = waiting[w];
+
+        if (requiredUnits[r] <= runLength - used)
+        {
+            currentJobId = jobIds[r];
+            markUnitsAllocated(runStart + used, requiredUnits[r]);
+            locations[r] = runStart + used;
+            used += requiredUnits[r];
+        }
+        else
+        {
+            waiting[kept++] = r;
+            if (requiredUnits[r] < smallestWaiting) smallestWaiting = requiredUnits[r];
+        }
+    }
+
+    waiting.resize(kept);
+}
+
+
+
+
+
 // getters for metrics
 
-int MemoryAllocator::getNumberOfAllocations() {return allocationCount;}
-int MemoryAllocator::getNumberOfAllocationOperations() { return allocationOperationCount;}
-int MemoryAllocator::getNumberOfFreeRequests() {return freeRequestCount;}
-int MemoryAllocator::getNumberOfFreeOperations() {return freeOperationCount; }
+long long MemoryAllocator::getNumberOfAllocations() {return allocationCount;}
+long long MemoryAllocator::getNumberOfAllocationOperations() { return allocationOperationCount;}
+long long MemoryAllocator::getNumberOfFreeRequests() {return freeRequestCount;}
+long long MemoryAllocator::getNumberOfFreeOperations() {return freeOperationCount; }
 
 
@@ -3,14 +3,21 @@
 
 #include <vector>
 #include <string>
+#include <map>
+#include <set>
+#include "operationhistogram.h"
+#include "binaryio.h"
+#include "freeblockindex.h"
+#include "ownershiprunmap.h"
+#include "unitjobarray.h"
 
 using namespace std;
 
 struct AllocationRecord
 {
-    int startIndex;
-    int unitCount;
-    int requestedBytes;
+    long long startIndex;
+    long long unitCount;
+    long long requestedBytes;
     int jobId;
     bool isActive;
 
@@ -30,59 +37,142 @@ class MemoryAllocator
 public:
     MemoryAllocator();
 
-    void configure(int memoryUnitSizeValue, int memoryUnitCountValue, const string &algorithmNameValue);
+    void configure(long long memoryUnitSizeValue, long long memoryUnitCountValue, const string &algorithmNameValue);
 
     // algorithms for each memory
-    int mallocFF(int sizeBytes);
-    int mallocNF(int sizeBytes);
-    int mallocBF(int sizeBytes);
-    int mallocWF(int sizeBytes);
+    long long mallocFF(long long sizeBytes);
+    long long mallocNF(long long sizeBytes);
+    long long mallocBF(long long sizeBytes);
+    long long mallocWF(long long sizeBytes);
+    long long mallocLA(long long sizeBytes, int lifetimeHint); //lifetime aware, hint = expected ticks alive, -1 unknown
+    long long mallocByType(long long sizeBytes, int lifetimeHint = -1); // calls the malloc picked by algorithmType
+
+    // one tick of requests in order, job id and lifetime hint per request (hints may be empty),
+    // locations -1 if it didnt fit. same result as setCurrentJobId + mallocByType for each,
+    // first fit places the whole batch in one pass over the free runs
+    void mallocBatch(const vector<long long> &sizes, const vector<int> &jobIds, const vector<int> &lifetimeHints, vector<long long> &locations);
 
     // free memory method to start somewhere
-    void freeFF(int startIndex);
+    void freeFF(long long startIndex);
+
+    // job arenas (jobArenas=true): release all active blocks of a job as one free request
+    void freeJobArena(int jobId, const vector<long long> &keepStarts, vector<long long> &releasedStarts);
+
+    // undo the last malloc when the caller could not use the block (a job whose
+    // stack did not fit): units, record, allocation count and the next fit
+    // position it had before go back, only its search operations stay counted.
+    // not a free request, so no free count, operations or histogram sample
+    void cancelAllocation(long long startIndex, long long nextFitStart);
 
     // tell allocator which job is making request
     void setCurrentJobId(int jobIdValue);
 
     // metrics
-    int getTotalMemorySize();
-    int getAllocatedMemorySize();
-    int getFreeMemorySize();
-    int getRequiredMemorySize();
-    int getExternalFragmentationCount();
-    int getLargestFreeBlockSize();
-    int getSmallestFreeBlockSize();
-
-    int getNumberOfAllocations();
-    int getNumberOfAllocationOperations();
-    int getNumberOfFreeRequests();
-    int getNumberOfFreeOperations();
+    long long getTotalMemorySize();
+    long long getAllocatedMemorySize();
+    long long getFreeMemorySize();
+    long long getRequiredMemorySize();
+    long long getExternalFragmentationCount();
+    long long getLargestFreeBlockSize();
+    long long getSmallestFreeBlockSize();
+
+    // time weighted totals: each value times the ticks it held. state only
+    // changes at ticks, so bringing the clock up to a tick before its events
+    // keeps them exact, and every value is a counter the engines keep anyway
+    void advanceClock(long long time);
+
+    long long getNumberOfAllocations();
+    long long getNumberOfAllocationOperations();
+    long long getNumberOfFreeRequests();
+    long long getNumberOfFreeOperations();
+
+    int getUnitJobId(long long unitIndex); //owner of a unit from whichever map is in use
+
+    // checkpoint, engine and ownership map independent: owners go out as runs
+    // and load into whichever map this allocator was configured with
+    void saveState(BinaryWriter &out);
+    bool loadState(BinaryReader &in);
 
     string algorithmName;
+    int algorithmType; // 0=FF 1=NF 2=BF 3=WF 4=LA
+    int lifetimeThreshold; // LA: hint <= threshold is short lived and goes low, longer goes to the top of memory
+    int engineType; // 0=scan unitJobId (reference) 1=indexed (free block index)
+    int ownershipType; // 0=unitJobId in memory 1=run map (forces indexed) 2=unitJobId mapped from a file, set before configure
+    string unitMapFilePath; //ownershipType=2
+    bool jobArenas; //track active blocks per job for freeJobArena, set before configure
 
-    int memoryUnitSize;
-    int memoryUnitCount;
+    long long memoryUnitSize;
+    long long memoryUnitCount;
 
     // -1 = free, else id
-    vector<int> unitJobId;
+    UnitJobArray unitJobId; //empty when ownershipType=1
+    OwnershipRunMap ownerRuns; //ownershipType=1
     vector<AllocationRecord> allocations;
 
-    int nextFitSearchStart;
+    // free block index. the indexed engine searches it and keeps it in step
+    // on every malloc and free; the scan engine only does that when
+    // trackFreeBlocks is set, otherwise it rebuilds it from unitJobId when
+    // asked (getFreeBlocks) so the reference scanners pay nothing for it
+    FreeBlockIndex freeBlocks;
+    bool trackFreeBlocks; //scan engine: keep freeBlocks in step anyway, for callers reading it every event. set before configure
+    bool freeBlocksStale; //scan engine, not tracking: freeBlocks is out of date
+    long long freeUnitCount; //scan engine, not tracking: free units and blocks for advanceClock, O(1) per mark
+    long long freeBlockCount;
 
-    int currentJobId;
+    bool keepsFreeBlocks(); //freeBlocks updated on every mark
+    FreeBlockIndex &getFreeBlocks(); //current index, rebuilt first if stale
+    map<long long, long long> activeRecordByStart; //start -> index into allocations
+    long long activeRequestedBytes;
+    map<int, set<long long>> arenaBlocksByJob; //jobId -> starts of its active blocks, jobArenas only
 
-    int allocationCount;
-    int allocationOperationCount;
-    int freeRequestCount;
-    int freeOperationCount;
+    long long nextFitSearchStart;
 
-    int allocateFirstFit(int requiredUnits); //method per type
-    int allocateNextFit(int requiredUnits);
-    int allocateBestFit(int requiredUnits);
-    int allocateWorstFit(int requiredUnits);
+    int currentJobId;
 
-    void markUnitsAllocated(int startIndex, int unitCount);
-    void markUnitsFree(int startIndex, int unitCount);
+    long long allocationCount;
+    long long allocationOperationCount;
+    long long freeRequestCount;
+    long long freeOperationCount;
+
+    long long clockTime; //integrals below cover [0, clockTime)
+    long long allocatedUnitTicks;
+    long long requiredByteTicks;
+    long long freeBlockTicks;
+
+    OperationHistogram allocationSearchHistogram; //units examined per malloc
+    OperationHistogram freeSearchHistogram; //records examined per free
+
+    long long allocateFirstFit(long long requiredUnits); //method per type
+    long long allocateNextFit(long long requiredUnits);
+    long long allocateBestFit(long long requiredUnits);
+    long long allocateWorstFit(long long requiredUnits);
+    long long allocateHighFit(long long requiredUnits); //LA long lived, highest block that fits, top end of it
+    long long allocateLifetimeAware(long long requiredUnits, int lifetimeHint);
+
+    // indexed engine, same placement and same operation counts as the scanners
+    long long allocateFirstFitIndexed(long long requiredUnits);
+    long long allocateNextFitIndexed(long long requiredUnits);
+    long long allocateBestFitIndexed(long long requiredUnits);
+    long long allocateWorstFitIndexed(long long requiredUnits);
+    long long allocateHighFitIndexed(long long requiredUnits);
+
+    // searches over a free block list, count scanner operations but dont place
+    long long findFirstFit(FreeBlockIndex &blocks, long long requiredUnits);
+    long long findNextFit(FreeBlockIndex &freeIndex, long long requiredUnits);
+    long long findBestFit(FreeBlockIndex &blocks, long long requiredUnits);
+    long long findWorstFit(FreeBlockIndex &blocks, long long requiredUnits);
+    long long findHighFit(FreeBlockIndex &blocks, long long requiredUnits);
+
+    bool isShortLived(int lifetimeHint); //unknown counts as short
+
+    // first fit mallocBatch: place the waiting requests that fit in one free run
+    void fillFreeRun(long long runStart, long long runLength, const vector<long long> &requiredUnits, const vector<int> &jobIds, vector<size_t> &waiting, long long &smallestWaiting, vector<long long> &locations);
+
+    void addAllocationRecord(long long location, long long requiredUnits, long long sizeBytes);
+    void releaseRecord(long long recordIndex); //free an active record's units and drop it from the maps
+
+    void markUnitsAllocated(long long startIndex, long long unitCount);
+    void markUnitsFree(long long startIndex, long long unitCount);
 };
 
 #endif // MEMORYALLOCATOR_H
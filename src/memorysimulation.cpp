@@ -1,5 +1,10 @@
 #include "memorysimulation.h"
 #include <iostream>
+#include <memory>
+#include <climits>
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
 
 
 
@@ -16,15 +21,158 @@ SimulationConfig::SimulationConfig() //default settings when ran w/o tokens
 
     seed = 125;
 
+    arrivalHorizon = 2000;
+    prefillTime = 2000;
+    sampleInterval = 200;
+    maxHeapElements = 20000;
+
+    steadyState = false;
+    steadyWindow = 10;
+    steadyTolerance = 10;
+    steadyHalfWidth = 5;
+
     summaryFilePath = "out/summary.csv";
     logFileFirstFit = "out/log_firstfit.csv";
     logFileNextFit = "out/log_nextfit.csv";
     logFileBestFit = "out/log_bestfit.csv";
     logFileWorstFit = "out/log_worstfit.csv";
+    logFileLifetimeAware = "out/log_lifetimeaware.csv";
+
+    asyncLogWriter = false;
+
+    logLevel = 3; //full log by default
+    logSampleEvery = 100;
+
+    usableRequestBytes = 50; //largest heap element
+    heatmapRows = 256;
+    heatmapInterval = 10;
+    heatmapMaxColumns = 1024;
+    reportFilePath = "out/report.json";
+    textReport = true;
+
+    profile = false;
+    perfCounters = false;
+
+    engineType = 0;
+    verifyEngines = false;
+
+    ownershipType = 0;
+    unitMapFilePrefix = "out/unitmap";
+
+    checkpointTime = -1;
+
+    batchHeapAllocs = true;
+
+    jobArenas = false;
+    orphanHeapPolicy = 0;
+
+    lifetimeAware = false;
+    lifetimeThreshold = 5;
+
+    jobModel = 0;
+
+    admissionQueue = false;
+}
+
+
+MemorySimulation::MemorySimulation() //constructor
+{
+    sampleCount = 0;
+    processedEventCount = 0;
+    logEventSequence = 0;
+    logSampledEvent = true;
+    currentEvent = nullptr;
+    currentEventTime = 0;
+    verifyCheckCount = 0;
+    verifyFailed = false;
+    printMessages = true;
+    checkpointFailed = false;
+    jobSourceActive = false;
+    jobSourceBaseTime = 1;
+    jobSourceNextArrival = 0;
+}
+
+
+void MemorySimulation::AlgorithmState::resetCounters()
+{
+    heapAllocCount = 0;
+    heapAllocBytes = 0;
+    sumPercentInUse = 0;
+    sumPercentInternal = 0;
+    maxPercentInUse = 0;
+    maxExternalFrag = 0;
+    orphanHeapElements = 0;
+    orphanHeapBytes = 0;
+    liveOrphanBytes = 0;
+    peakLiveOrphanBytes = 0;
+    freedSinceRetry = false;
+    queuedRequests = 0;
+    admittedRequests = 0;
+    abandonedRequests = 0;
+    waitHistogram.reset();
+    totalWaitTicks = 0;
+    queueLengthSum = 0;
+    queueTicks = 0;
+    peakQueueLength = 0;
+    finishedJobs = 0;
+    delayedJobs = 0;
+    sumSlowdownPercent = 0;
+    maxSlowdownPercent = 0;
+    mallocCalls = 0;
+    mallocNanoseconds = 0;
+    freeCalls = 0;
+    freeNanoseconds = 0;
+    eventNanoseconds = 0;
+    mallocCounters = PerfCounterValues();
+    freeCounters = PerfCounterValues();
+}
+
+// 100*part/whole, split so the multiply cant overflow on huge memories
+int MemorySimulation::percentOf(long long part, long long whole)
+{
+    if (whole <= 0) return 0;
+
+    long long wholePercent = part / whole;
+    long long remainder = part % whole;
+
+    if (remainder <= LLONG_MAX / 100) return (int)(wholePercent * 100 + (remainder * 100) / whole);
+
+    return (int)(wholePercent * 100 + (long long)(((long double)remainder * 100) / whole)); //only near LLONG_MAX
+}
+
+
+// out/summary.csv -> out/<subdirectory>/summary.csv, for runs sharing one
+// process (replicas, batch tests). directory made here since the csv
+// writers dont make their own
+static string redirectPath(const string &path, const string &subdirectory)
+{
+    if (path.empty()) return path;
+
+    filesystem::path original(path);
+    filesystem::path directory = original.parent_path() / subdirectory;
+
+    error_code ec;
+    filesystem::create_directories(directory, ec); //errors show up when the file is opened
+
+    return (directory / original.filename()).string();
 }
 
 
-MemorySimulation::MemorySimulation(){} //constructor
+void SimulationConfig::redirectOutputs(const string &subdirectory)
+{
+    summaryFilePath = redirectPath(summaryFilePath, subdirectory);
+    logFileFirstFit = redirectPath(logFileFirstFit, subdirectory);
+    logFileNextFit = redirectPath(logFileNextFit, subdirectory);
+    logFileBestFit = redirectPath(logFileBestFit, subdirectory);
+    logFileWorstFit = redirectPath(logFileWorstFit, subdirectory);
+    logFileLifetimeAware = redirectPath(logFileLifetimeAware, subdirectory);
+    reportFilePath = redirectPath(reportFilePath, subdirectory);
+    timeSeriesFilePath = redirectPath(timeSeriesFilePath, subdirectory);
+    freeBlockFilePath = redirectPath(freeBlockFilePath, subdirectory);
+    heatmapFilePrefix = redirectPath(heatmapFilePrefix, subdirectory);
+    unitMapFilePrefix = redirectPath(unitMapFilePrefix, subdirectory);
+}
+
 
 int MemorySimulation::HeapElement::getDepartureTime() const
 {
@@ -42,10 +190,47 @@ void MemorySimulation::configure(const SimulationConfig &cfg)
 //config all allocs to same memory size
 void MemorySimulation::initializeAllocators()
 {
-    allocatorFirstFit.configure(config.memoryUnitSize, config.memoryUnitCount, "First Fit");
-    allocatorNextFit.configure(config.memoryUnitSize, config.memoryUnitCount, "Next Fit");
-    allocatorBestFit.configure(config.memoryUnitSize, config.memoryUnitCount, "Best Fit");
-    allocatorWorstFit.configure(config.memoryUnitSize, config.memoryUnitCount, "Worst Fit");
+    const char *names[5] = {"First Fit", "Next Fit", "Best Fit", "Worst Fit", "Lifetime Aware"};
+    const char *shortNames[5] = {"FF", "NF", "BF", "WF", "LA"};
+    string logPaths[5] = {config.logFileFirstFit, config.logFileNextFit, config.logFileBestFit, config.logFileWorstFit, config.logFileLifetimeAware};
+
+    int laneCount = config.lifetimeAware ? 5 : 4;
+
+    algorithms.clear();
+    algorithms.resize(laneCount);
+
+    for (int a = 0; a < laneCount; a++)
+    {
+        AlgorithmState &state = algorithms[a];
+        state.shortName = shortNames[a];
+        state.logFilePath = logPaths[a];
+        state.allocator.algorithmType = a; //same order as the type codes
+        state.allocator.engineType = config.engineType;
+        state.allocator.ownershipType = config.ownershipType;
+        state.allocator.unitMapFilePath = config.unitMapFilePrefix + "_" + state.shortName + ".bin";
+        state.allocator.jobArenas = config.jobArenas;
+        state.allocator.lifetimeThreshold = config.lifetimeThreshold;
+        // the scan engine keeps its free block index in step only when something reads it
+        // (every event for the time series, every sample or column for the histogram and
+        // heatmap), a sweep per read would cost more
+        state.allocator.trackFreeBlocks = !config.timeSeriesFilePath.empty() || !config.freeBlockFilePath.empty() || !config.heatmapFilePrefix.empty();
+        state.allocator.configure(config.memoryUnitSize, config.memoryUnitCount, names[a]); //may force indexed
+
+        if (config.ownershipType == 2 && !state.allocator.unitJobId.isMapped())
+        {
+            message("Warning: could not map " + state.allocator.unitMapFilePath + ", keeping unitJobId in memory\n");
+        }
+
+        if (config.verifyEngines)
+        {
+            state.verifyAllocator.algorithmType = a;
+            state.verifyAllocator.engineType = (state.allocator.engineType == 0) ? 1 : 0; //the other one
+            state.verifyAllocator.ownershipType = 0; //scanner needs the vector
+            state.verifyAllocator.jobArenas = config.jobArenas;
+            state.verifyAllocator.lifetimeThreshold = config.lifetimeThreshold;
+            state.verifyAllocator.configure(config.memoryUnitSize, config.memoryUnitCount, names[a]);
+        }
+    }
 }
 
 int MemorySimulation::chooseJobType() // choose S/M/L based on %
@@ -108,7 +293,7 @@ void MemorySimulation::createHeapElementsForJob(const Job &job)
 
 
     if (job.heapElementCount <= 0 || job.runTime <= 0) return;
-    if ((int)heapElements.size() > 20000) return;
+    if ((int)heapElements.size() > config.maxHeapElements) return;
     // hard cap total heap element (its taking insanely long)
 
 
@@ -132,83 +317,271 @@ void MemorySimulation::createHeapElementsForJob(const Job &job)
             heapElements.push_back(element);
 
               //make sure heap vectors updated (free)
-            heapLocationFF.push_back(-1);
-            heapLocationNF.push_back(-1);
-            heapLocationBF.push_back(-1);
-            heapLocationWF.push_back(-1);
+            for (size_t a = 0; a < algorithms.size(); a++)
+            {
+                algorithms[a].heapLocation.push_back(-1);
+                algorithms[a].heapDelay.push_back(0);
+                algorithms[a].heapWaiting.push_back(0);
+            }
         }
     }
 }
 
 
 void MemorySimulation::buildJobsAndHeapElements()
+{
+    startJobSource();
+    generateJobsUntil(INT_MAX); //whole workload up front
+}
+
+
+// clears the workload and draws the first arrival
+void MemorySimulation::startJobSource()
 {
     //clear all for job and heap sizes
     jobs.clear();
     heapElements.clear();
-    jobCodeLocationFF.clear();
-    jobStackLocationFF.clear();
-    jobCodeLocationNF.clear();
-    jobStackLocationNF.clear();
-    jobCodeLocationBF.clear();
-    jobStackLocationBF.clear();
-    jobCodeLocationWF.clear();
-    jobStackLocationWF.clear();
-    heapLocationFF.clear();
-    heapLocationNF.clear();
-    heapLocationBF.clear();
-    heapLocationWF.clear();
+    jobHeapElements.clear();
+    for (size_t a = 0; a < algorithms.size(); a++)
+    {
+        algorithms[a].jobCodeLocation.clear();
+        algorithms[a].jobStackLocation.clear();
+        algorithms[a].heapLocation.clear();
+        algorithms[a].waitQueue.clear();
+        algorithms[a].jobDelay.clear();
+        algorithms[a].jobBlocked.clear();
+        algorithms[a].heldEvents.clear();
+        algorithms[a].deferredEvents.reset(0);
+        algorithms[a].heapDelay.clear();
+        algorithms[a].heapWaiting.clear();
+    }
     //
 
-    int jobIdValue = 0;
-    int endTime = 2000; //prefill phase
-
-    int baseTime = 1;
+    jobSourceBaseTime = 1;
     int offset = rng.randomInclusive(0, 4); // 0 to 4 for 3 +/- 2
-    int nextArrival = baseTime + offset;
+    jobSourceNextArrival = jobSourceBaseTime + offset;
+    jobSourceActive = true;
+}
+
 
-    while (nextArrival < endTime)
+// makes every job whose base time is <= baseTimeLimit. a job arrives 0-4
+// ticks after its base time, so making it at its base time is never late,
+// and jobs are always drawn in id order whoever calls this
+void MemorySimulation::generateJobsUntil(int baseTimeLimit)
+{
+    int endTime = config.arrivalHorizon; //no arrivals from here on
+
+    while (jobSourceActive && jobSourceBaseTime <= baseTimeLimit)
     {
-        Job job = createRandomJob(jobIdValue, nextArrival);
+        if (jobSourceNextArrival >= endTime)
+        {
+            jobSourceActive = false;
+            break;
+        }
+
+        Job job = createRandomJob((int)jobs.size(), jobSourceNextArrival);
 
         jobs.push_back(job);
 
         //keep job location vectors in sync
-        jobCodeLocationFF.push_back(-1);
-        jobStackLocationFF.push_back(-1);
-        jobCodeLocationNF.push_back(-1);
-        jobStackLocationNF.push_back(-1);
-        jobCodeLocationBF.push_back(-1);
-        jobStackLocationBF.push_back(-1);
-        jobCodeLocationWF.push_back(-1);
-        jobStackLocationWF.push_back(-1);
+        for (size_t a = 0; a < algorithms.size(); a++)
+        {
+            algorithms[a].jobCodeLocation.push_back(-1);
+            algorithms[a].jobStackLocation.push_back(-1);
+            algorithms[a].jobDelay.push_back(0);
+            algorithms[a].jobBlocked.push_back(0);
+            algorithms[a].heldEvents.push_back(vector<Event>());
+        }
 
+        int firstElement = (int)heapElements.size();
         createHeapElementsForJob(job);
 
-        jobIdValue++;
+        jobHeapElements.push_back(vector<int>());
+        for (int e = firstElement; e < (int)heapElements.size(); e++) jobHeapElements.back().push_back(e);
 
-        baseTime = baseTime + 3;           //next step(1,4,7...)
-        offset = rng.randomInclusive(0, 4); //new rand
-        nextArrival = baseTime + offset;
+        jobSourceBaseTime = jobSourceBaseTime + 3;  //next step(1,4,7...)
+        int offset = rng.randomInclusive(0, 4);     //new rand
+        jobSourceNextArrival = jobSourceBaseTime + offset;
     }
 }
 
 
-void MemorySimulation::buildEvents() // create job, stack, heap events
+shared_ptr<const MemorySimulation::Workload> MemorySimulation::generateWorkload(const SimulationConfig &cfg)
 {
-    int lastEventTime = 0;
-    if (!events.empty())
+    MemorySimulation simulation; //no lanes, so nothing per algorithm gets sized
+    simulation.config = cfg;
+    simulation.rng.reseed(cfg.seed);
+
+    simulation.startJobSource();
+    simulation.generateJobsUntil(INT_MAX);
+
+    shared_ptr<Workload> workload = make_shared<Workload>();
+    workload->jobs.swap(simulation.jobs);
+    workload->heapElements.swap(simulation.heapElements);
+    workload->rng = simulation.rng;
+    workload->jobSourceBaseTime = simulation.jobSourceBaseTime;
+    workload->jobSourceNextArrival = simulation.jobSourceNextArrival;
+    return workload;
+}
+
+
+// same state buildJobsAndHeapElements leaves, without drawing anything
+void MemorySimulation::adoptWorkload(const Workload &workload)
+{
+    jobs = workload.jobs;
+    heapElements = workload.heapElements;
+    rng = workload.rng;
+    jobSourceActive = false;
+    jobSourceBaseTime = workload.jobSourceBaseTime;
+    jobSourceNextArrival = workload.jobSourceNextArrival;
+
+    size_t jobCount = jobs.size();
+    size_t elementCount = heapElements.size();
+    for (size_t a = 0; a < algorithms.size(); a++)
     {
-        lastEventTime = events[(int)events.size() - 1].time; //time of last event
+        AlgorithmState &state = algorithms[a];
+        state.jobCodeLocation.assign(jobCount, -1);
+        state.jobStackLocation.assign(jobCount, -1);
+        state.jobDelay.assign(jobCount, 0);
+        state.jobBlocked.assign(jobCount, 0);
+        state.heldEvents.assign(jobCount, vector<Event>());
+        state.waitQueue.clear();
+        state.deferredEvents.reset(0);
+        state.heapLocation.assign(elementCount, -1);
+        state.heapDelay.assign(elementCount, 0);
+        state.heapWaiting.assign(elementCount, 0);
     }
-    int endTime = lastEventTime;
-    int prefillTime = 2000;
 
-    if (endTime < prefillTime) endTime = prefillTime; // so endTime is at least the prefillTime
+    indexJobHeapElements();
+}
+
+
+void MemorySimulation::indexJobHeapElements()
+{
+    jobHeapElements.assign(jobs.size(), vector<int>()); //arena departures look up a jobs heap
+    for (size_t i = 0; i < heapElements.size(); i++) jobHeapElements[heapElements[i].jobId].push_back((int)i);
+}
+
+
+// --jobModel coroutine --------------------------------------------------
+// one job from arrival to its last heap free as a coroutine, yielding the
+// same events buildEvents makes for it, one tick at a time. ticks before
+// startTime are skipped, a checkpoint resume restarts live jobs that way.
+// the frame keeps element ids, not copies: the elements stay in heapElements,
+// which can grow while the frame is suspended, so they are looked up by
+// index every time instead of held by reference
+JobProcess MemorySimulation::runJobProcess(Job job, int startTime)
+{
+    int departureTime = job.arrivalTime + job.runTime;
+
+    vector<int> elements = jobHeapElements[job.jobId]; //ids, arrival order
+
+    vector<int> freeOrder = elements; //ids by free time, id order within a tick
+    stable_sort(freeOrder.begin(), freeOrder.end(), [this](int x, int y)
+    {
+        return heapElements[x].getDepartureTime() < heapElements[y].getDepartureTime();
+    });
+
+    bool arrived = job.arrivalTime < startTime;
+    bool departed = departureTime < startTime;
+    size_t nextAlloc = 0; //elements come in arrival order
+    size_t nextFree = 0;
+    while (nextAlloc < elements.size() && heapElements[elements[nextAlloc]].arrivalTime < startTime) nextAlloc++;
+    while (nextFree < freeOrder.size() && heapElements[freeOrder[nextFree]].getDepartureTime() < startTime) nextFree++;
+
+    while (true)
+    {
+        // next tick with something to do
+        int time = INT_MAX;
+        if (!arrived) time = job.arrivalTime;
+        if (!departed) time = min(time, departureTime);
+        if (nextAlloc < elements.size()) time = min(time, heapElements[elements[nextAlloc]].arrivalTime);
+        if (nextFree < freeOrder.size()) time = min(time, heapElements[freeOrder[nextFree]].getDepartureTime());
+        if (time == INT_MAX) break;
+
+        co_await JobProcess::WaitUntil{time};
+
+        // same type order the calendar pops in
+        if (!arrived && job.arrivalTime == time)
+        {
+            Event ev;
+            ev.time = time;
+            ev.jobId = job.jobId;
+            ev.eventType = 0;
+            co_yield ev;
+            arrived = true;
+        }
+
+        if (!departed && departureTime == time)
+        {
+            Event ev;
+            ev.time = time;
+            ev.jobId = job.jobId;
+            ev.eventType = 1;
+            co_yield ev;
+            departed = true;
+        }
+
+        while (nextAlloc < elements.size() && heapElements[elements[nextAlloc]].arrivalTime == time)
+        {
+            Event ev;
+            ev.time = time;
+            ev.jobId = job.jobId;
+            ev.elementId = heapElements[elements[nextAlloc]].elementId;
+            ev.eventType = 2;
+            co_yield ev;
+            nextAlloc++;
+        }
+
+        while (nextFree < freeOrder.size() && heapElements[freeOrder[nextFree]].getDepartureTime() == time)
+        {
+            Event ev;
+            ev.time = time;
+            ev.jobId = job.jobId;
+            ev.elementId = heapElements[freeOrder[nextFree]].elementId;
+            ev.eventType = 3;
+            co_yield ev;
+            nextFree++;
+        }
+    }
+}
+
+
+JobProcess MemorySimulation::startJobProcess(const Job &job, int startTime)
+{
+    JobProcess process = runJobProcess(job, startTime);
+    process.jobId = job.jobId;
+    return process;
+}
+
+
+// new jobs, then every live job in id order hands over this ticks events,
+// which puts them in the calendar in the order buildEvents would have
+void MemorySimulation::advanceJobProcesses(int currentTime)
+{
+    int firstNewJob = (int)jobs.size();
+    generateJobsUntil(currentTime);
+    for (int j = firstNewJob; j < (int)jobs.size(); j++) liveJobs.push_back(startJobProcess(jobs[j], currentTime));
+
+    vector<Event> tickEvents;
+    for (size_t i = 0; i < liveJobs.size(); i++) liveJobs[i].runTick(currentTime, tickEvents);
+    for (size_t i = 0; i < tickEvents.size(); i++) calendar.schedule(currentTime, tickEvents[i]);
 
+    // finished frames go, the rest keep their order
+    size_t kept = 0;
+    for (size_t i = 0; i < liveJobs.size(); i++)
+    {
+        if (liveJobs[i].done()) continue;
+        if (kept != i) liveJobs[kept] = move(liveJobs[i]);
+        kept++;
+    }
+    liveJobs.erase(liveJobs.begin() + kept, liveJobs.end());
+}
 
 
-    events.clear();
+void MemorySimulation::buildEvents() // create job, stack, heap events
+{
+    calendar.reset(0); //fills in (time, type) order as it goes, no sort
 
     int jobCount = (int)jobs.size();
     for (int i = 0; i < jobCount; i++)
@@ -221,14 +594,14 @@ void MemorySimulation::buildEvents() // create job, stack, heap events
         arriveEvent.jobId = job.jobId;
         arriveEvent.eventType = 0;
 
-        events.push_back(arriveEvent);
+        calendar.schedule(arriveEvent.time, arriveEvent);
 
         //job departures
         Event departEvent;
         departEvent.time = job.arrivalTime + job.runTime;
         departEvent.jobId = job.jobId;
         departEvent.eventType = 1;
-        events.push_back(departEvent);
+        calendar.schedule(departEvent.time, departEvent);
     }
 
     int heapCount = (int)heapElements.size(); //heap elements generated
@@ -241,39 +614,36 @@ void MemorySimulation::buildEvents() // create job, stack, heap events
         allocEvent.jobId = element.jobId;
         allocEvent.elementId = element.elementId;
         allocEvent.eventType = 2; //2=heap alloc
-        events.push_back(allocEvent); //store to events
+        calendar.schedule(allocEvent.time, allocEvent);
 
         Event freeEvent;
         freeEvent.time = element.getDepartureTime(); //which is arrival+lifetime
         freeEvent.jobId = element.jobId;
         freeEvent.elementId = element.elementId;
         freeEvent.eventType = 3; //3=heap free
-        events.push_back(freeEvent);
+        calendar.schedule(freeEvent.time, freeEvent);
     }
+}
 
-    //bubble sort by time then event type
-    int n = (int)events.size();
-    for (int i = 0; i < n; i++)
-    {
-        for (int j = i + 1; j < n; j++)
-        {
-            bool swap = false;
+// decide if a row gets written, before any row values are built
+bool MemorySimulation::shouldLog(bool failed)
+{
+    if (config.logLevel <= 0) return false; //none
 
-            if (events[j].time < events[i].time) swap = true;
-            else if (events[j].time == events[i].time && events[j].eventType < events[i].eventType) swap = true;
-            if (swap)
-            {
-                Event temp = events[i];
-                events[i] = events[j];
-                events[j] = temp;
-            }
-        }
-    }
+    if (failed) return true; //failed allocs kept at every level above none
+
+    if (config.logLevel == 1) return false; //failures only
+
+    if (config.logLevel == 2) return logSampledEvent; //1 in N events
+
+    return true; //full
 }
 
        //log allocation row to csvwriter
-void MemorySimulation::logAllocation(CsvWriter &writer, int time, int jobId, int sizeBytes, int location)
+void MemorySimulation::logAllocation(CsvWriter &writer, int time, int jobId, int sizeBytes, long long location)
 {
+    if (!shouldLog(location == -1)) return;
+
     vector<string> rowValues; //1 csv row
     rowValues.push_back(to_string(time));
     rowValues.push_back(to_string(jobId));
@@ -284,8 +654,10 @@ void MemorySimulation::logAllocation(CsvWriter &writer, int time, int jobId, int
 }
 
 
-void MemorySimulation::logFree(CsvWriter &writer, int time, int jobId, int location)
+void MemorySimulation::logFree(CsvWriter &writer, int time, int jobId, long long location)
 {
+    if (!shouldLog(false)) return;
+
     vector<string> rowValues;
     rowValues.push_back(to_string(time));
     rowValues.push_back(to_string(jobId));
@@ -297,1030 +669,1704 @@ void MemorySimulation::logFree(CsvWriter &writer, int time, int jobId, int locat
 
 
 
-void MemorySimulation::processEventsAtTime(int currentTime, CsvWriter &logFF, CsvWriter &logNF,CsvWriter &logBF, CsvWriter &logWF)
+void MemorySimulation::logQueued(CsvWriter &writer, int time, int jobId, int sizeBytes)
 {
-    int eventCount = (int)events.size();
+    if (!shouldLog(true)) return; //kept like a failed alloc
 
-    for (int i = 0; i < eventCount; i++)
-    {
-        Event &ev = events[i];
+    vector<string> rowValues;
+    rowValues.push_back(to_string(time));
+    rowValues.push_back(to_string(jobId));
+    rowValues.push_back("queued");
+    rowValues.push_back(to_string(sizeBytes));
+    rowValues.push_back("-1");
+    writer.row(rowValues);
+}
+
+
+
+void MemorySimulation::processEventsAtTime(int currentTime)
+{
+    Event ev;
 
-        if (ev.time != currentTime) continue; // skip events that are not scheduled
+    // the integrals take the state the last tick left before anything moves
+    for (size_t a = 0; a < algorithms.size(); a++) algorithms[a].allocator.advanceClock(currentTime);
 
-        if (ev.eventType == 0)
+    while (calendar.popNext(currentTime, ev)) //this tick only, by event type
+    {
+        if (config.batchHeapAllocs && !config.admissionQueue && ev.eventType == 2) //the ticks heap allocs come out together
         {
-            //allocate code and stack for each job arrival based off which alg type
-            const Job &job = jobs[ev.jobId];
+            vector<Event> batch(1, ev);
+            int nextType;
+            while (calendar.peekType(currentTime, nextType) && nextType == 2 && calendar.popNext(currentTime, ev)) batch.push_back(ev);
 
-            // FF code+stack
-            allocatorFirstFit.setCurrentJobId(job.jobId); //which job?
-            int locCodeFF = allocatorFirstFit.mallocFF(job.codeSize); //alloc code and stack
-            int locStackFF = allocatorFirstFit.mallocFF(job.stackSize);
-            jobCodeLocationFF[job.jobId] = locCodeFF;
-            jobStackLocationFF[job.jobId] = locStackFF; //store code and stack to free later
-            logAllocation(logFF, currentTime, job.jobId, job.codeSize, locCodeFF);
-            logAllocation(logFF, currentTime, job.jobId, job.stackSize, locStackFF); //write to log
-
-
-            //NF
-            allocatorNextFit.setCurrentJobId(job.jobId);
-            int locCodeNF = allocatorNextFit.mallocNF(job.codeSize);
-            int locStackNF = allocatorNextFit.mallocNF(job.stackSize);
-            jobCodeLocationNF[job.jobId] = locCodeNF;
-            jobStackLocationNF[job.jobId] = locStackNF;
-            logAllocation(logNF, currentTime, job.jobId, job.codeSize, locCodeNF);
-            logAllocation(logNF, currentTime, job.jobId, job.stackSize, locStackNF);
-
-            //BF
-            allocatorBestFit.setCurrentJobId(job.jobId);
-            int locCodeBF = allocatorBestFit.mallocBF(job.codeSize);
-            int locStackBF = allocatorBestFit.mallocBF(job.stackSize);
-            jobCodeLocationBF[job.jobId] = locCodeBF;
-            jobStackLocationBF[job.jobId] = locStackBF;
-            logAllocation(logBF, currentTime, job.jobId, job.codeSize, locCodeBF);
-            logAllocation(logBF, currentTime, job.jobId, job.stackSize, locStackBF);
-
-            //WF
-            allocatorWorstFit.setCurrentJobId(job.jobId);
-            int locCodeWF = allocatorWorstFit.mallocWF(job.codeSize);
-            int locStackWF = allocatorWorstFit.mallocWF(job.stackSize);
-            jobCodeLocationWF[job.jobId] = locCodeWF;
-            jobStackLocationWF[job.jobId] = locStackWF;
-            logAllocation(logWF, currentTime, job.jobId, job.codeSize, locCodeWF);
-            logAllocation(logWF, currentTime, job.jobId, job.stackSize, locStackWF);
+            processHeapAllocBatch(batch, currentTime);
+            if (timeSeries.isOpen()) recordTimeSeries(currentTime);
+            continue;
         }
 
-        else if (ev.eventType == 1)
+        //same events sampled for every algorithm so logs line up
+        if (config.logLevel == 2)
         {
-            // job departure, free, for each type
-            const Job &job = jobs[ev.jobId];
+            int every = config.logSampleEvery;
+            if (every <= 0) every = 1;
 
-            //FF
-            int locCodeFF = jobCodeLocationFF[job.jobId];
-            int locStackFF = jobStackLocationFF[job.jobId];
+            logSampledEvent = (logEventSequence % every == 0);
+            logEventSequence++;
+        }
 
-            if (locCodeFF >= 0)
-            {
-                allocatorFirstFit.freeFF(locCodeFF);
-                logFree(logFF, currentTime, job.jobId, locCodeFF);
-            }
+        processedEventCount++;
+        currentEvent = &ev;
+        currentEventTime = currentTime;
 
-            if (locStackFF >= 0)
-            {
-                allocatorFirstFit.freeFF(locStackFF);
-                logFree(logFF, currentTime, job.jobId, locStackFF);
-            }
+        // each algorithm runs the same event on its own memory
+        for (size_t a = 0; a < algorithms.size(); a++)
+        {
+            AlgorithmState &state = algorithms[a];
+            ScopedTimer timer(profiler, -1, state.eventNanoseconds);
 
+            if (config.admissionQueue) dispatchEvent(state, ev, currentTime);
+            else processEventForAlgorithm(state, ev, currentTime);
+        }
 
-            //NF
-            int locCodeNF = jobCodeLocationNF[job.jobId];
-            int locStackNF = jobStackLocationNF[job.jobId];
+        if (timeSeries.isOpen()) recordTimeSeries(currentTime);
+    }
 
-            if (locCodeNF >= 0)
-            {
-                allocatorNextFit.freeFF(locCodeNF);
-                logFree(logNF, currentTime, job.jobId, locCodeNF);
-            }
+    if (!config.admissionQueue) return;
 
-            if (locStackNF >= 0)
-            {
-                allocatorNextFit.freeFF(locStackNF);
-                logFree(logNF, currentTime, job.jobId, locStackNF);
-            }
+    // delayed jobs catch up, then whatever waits gets another try
+    for (size_t a = 0; a < algorithms.size(); a++)
+    {
+        AlgorithmState &state = algorithms[a];
+        ScopedTimer timer(profiler, -1, state.eventNanoseconds);
 
+        runDeferredEvents(state, currentTime);
+        retryWaitingRequests(state, currentTime);
 
+        long long queueLength = (long long)state.waitQueue.size();
+        state.queueLengthSum += queueLength;
+        state.queueTicks++;
+        if (queueLength > state.peakQueueLength) state.peakQueueLength = queueLength;
+    }
 
-            //BF
-            int locCodeBF = jobCodeLocationBF[job.jobId];
-            int locStackBF = jobStackLocationBF[job.jobId];
+    if (timeSeries.isOpen()) recordTimeSeries(currentTime); //what the retries placed
+}
 
-            if (locCodeBF >= 0)
-            {
-                allocatorBestFit.freeFF(locCodeBF);
-                logFree(logBF, currentTime, job.jobId, locCodeBF);
-            }
 
-            if (locStackBF >= 0)
-            {
-                allocatorBestFit.freeFF(locStackBF);
-                logFree(logBF, currentTime, job.jobId, locStackBF);
-            }
+// --timeSeries, straight from the free block index and the requested byte
+// total, the scanning getters would cost a pass per event. with the time
+// series on, the scan engine keeps its index in step too (trackFreeBlocks)
+void MemorySimulation::recordTimeSeries(int time)
+{
+    for (size_t a = 0; a < algorithms.size(); a++)
+    {
+        MemoryAllocator &allocator = algorithms[a].allocator;
+        FreeBlockIndex &blocks = allocator.getFreeBlocks();
 
+        long long allocatedBytes = (allocator.memoryUnitCount - blocks.getFreeUnits()) * allocator.memoryUnitSize;
+        long long largestFreeBytes = blocks.getLargestBlock() * allocator.memoryUnitSize;
 
-            //WF
-            int locCodeWF = jobCodeLocationWF[job.jobId];
-            int locStackWF = jobStackLocationWF[job.jobId];
+        timeSeries.record((int)a, time, allocatedBytes, allocator.activeRequestedBytes, blocks.getBlockCount(), largestFreeBytes);
+    }
+}
 
-            if (locCodeWF >= 0)
-            {
-                allocatorWorstFit.freeFF(locCodeWF);
-                logFree(logWF, currentTime, job.jobId, locCodeWF);
-            }
 
-            if (locStackWF >= 0)
-            {
-                allocatorWorstFit.freeFF(locStackWF);
-                logFree(logWF, currentTime, job.jobId, locStackWF);
-            }
+// heap alloc events of one tick, one mallocBatch per algorithm
+// instead of one search per element, logs and counters same as one by one
+void MemorySimulation::processHeapAllocBatch(const vector<Event> &batch, int currentTime)
+{
+    vector<long long> sizes;
+    vector<int> jobIds;
+    vector<int> lifetimeHints; //only LA looks at them
+    vector<char> sampled; //sampler decision per event, drawn in event order
 
+    for (size_t i = 0; i < batch.size(); i++)
+    {
+        const HeapElement &element = heapElements[batch[i].elementId];
+        sizes.push_back(element.sizeBytes);
+        jobIds.push_back(element.jobId);
+        lifetimeHints.push_back(element.lifetime);
+
+        bool keep = true;
+        if (config.logLevel == 2)
+        {
+            int every = config.logSampleEvery;
+            if (every <= 0) every = 1;
+
+            keep = (logEventSequence % every == 0);
+            logEventSequence++;
         }
+        sampled.push_back(keep);
+    }
 
+    processedEventCount += (long long)batch.size();
+    currentEvent = &batch[0];
+    currentEventTime = currentTime;
 
+    vector<long long> locations;
+    for (size_t a = 0; a < algorithms.size(); a++)
+    {
+        AlgorithmState &state = algorithms[a];
+        ScopedTimer timer(profiler, -1, state.eventNanoseconds);
 
-        else if (ev.eventType == 2)
-        { // heap alloc for element for each type
+        timedMallocBatch(state, sizes, jobIds, lifetimeHints, locations);
 
-            const HeapElement &element = heapElements[ev.elementId];
+        for (size_t i = 0; i < batch.size(); i++)
+        {
+            const HeapElement &element = heapElements[batch[i].elementId];
+            long long loc = locations[i];
 
-            //FF
-            allocatorFirstFit.setCurrentJobId(element.jobId);
-            int locFF = allocatorFirstFit.mallocFF(element.sizeBytes);
-            heapLocationFF[element.elementId] = locFF;
-            logAllocation(logFF, currentTime, element.jobId, element.sizeBytes, locFF);
-            if (locFF >= 0)
+            state.heapLocation[element.elementId] = loc;
+            logSampledEvent = sampled[i];
+            logAllocation(*state.log, currentTime, element.jobId, element.sizeBytes, loc);
+            if (loc >= 0)
             {
-                heapAllocCountFF++;
-                heapAllocBytesFF += element.sizeBytes;
+                state.heapAllocCount++;
+                state.heapAllocBytes += element.sizeBytes;
             }
+        }
+    }
+}
 
-            //NF
-            allocatorNextFit.setCurrentJobId(element.jobId);
-            int locNF = allocatorNextFit.mallocNF(element.sizeBytes);
-            heapLocationNF[element.elementId] = locNF;
-            logAllocation(logNF, currentTime, element.jobId, element.sizeBytes, locNF);
-            if (locNF >= 0)
-            {
-                heapAllocCountNF++;
-                heapAllocBytesNF += element.sizeBytes;
-            }
 
-            //BF
-            allocatorBestFit.setCurrentJobId(element.jobId);
-            int locBF = allocatorBestFit.mallocBF(element.sizeBytes);
-            heapLocationBF[element.elementId] = locBF;
-            logAllocation(logBF, currentTime, element.jobId, element.sizeBytes, locBF);
-            if (locBF >= 0)
-            {
-                heapAllocCountBF++;
-                heapAllocBytesBF += element.sizeBytes;
-            }
+void MemorySimulation::processEventForAlgorithm(AlgorithmState &state, const Event &ev, int currentTime)
+{
+    CsvWriter &log = *state.log;
 
-            //WF
-            allocatorWorstFit.setCurrentJobId(element.jobId);
-            int locWF = allocatorWorstFit.mallocWF(element.sizeBytes);
-            heapLocationWF[element.elementId] = locWF;
-            logAllocation(logWF, currentTime, element.jobId, element.sizeBytes, locWF);
-            if (locWF >= 0)
-            {
-                heapAllocCountWF++;
-                heapAllocBytesWF += element.sizeBytes;
-            }
+    if (ev.eventType == 0)
+    {
+        //allocate code and stack for job arrival
+        const Job &job = jobs[ev.jobId];
+
+        if (config.admissionQueue)
+        {
+            if (!placeJob(state, job, currentTime)) queueRequest(state, job.jobId, -1, job.codeSize + job.stackSize, currentTime);
+            return;
+        }
+
+        setJobForAlgorithm(state, job.jobId); //which job?
+        long long locCode = timedMalloc(state, job.codeSize, job.runTime); //alloc code and stack, they live as long as the job
+        long long locStack = timedMalloc(state, job.stackSize, job.runTime);
+        state.jobCodeLocation[job.jobId] = locCode;
+        state.jobStackLocation[job.jobId] = locStack; //store code and stack to free later
+        logAllocation(log, currentTime, job.jobId, job.codeSize, locCode);
+        logAllocation(log, currentTime, job.jobId, job.stackSize, locStack); //write to log
+    }
+
+    else if (ev.eventType == 1)
+    {
+        // job departure, free code and stack
+        const Job &job = jobs[ev.jobId];
 
+        if (config.admissionQueue)
+        {
+            finishJob(state, job);
+            state.freedSinceRetry = true;
+        }
 
+        if (config.jobArenas)
+        {
+            releaseJobArena(state, job, currentTime);
+            return;
         }
 
+        long long locCode = state.jobCodeLocation[job.jobId];
+        long long locStack = state.jobStackLocation[job.jobId];
 
-        else if (ev.eventType == 3)
+        if (locCode >= 0)
         {
-            // heap free for each type
-            int locFF = heapLocationFF[ev.elementId];
-            int locNF = heapLocationNF[ev.elementId];
-            int locBF = heapLocationBF[ev.elementId];
-            int locWF = heapLocationWF[ev.elementId];
+            timedFree(state, locCode);
+            logFree(log, currentTime, job.jobId, locCode);
+        }
 
+        if (locStack >= 0)
+        {
+            timedFree(state, locStack);
+            logFree(log, currentTime, job.jobId, locStack);
+        }
+    }
 
-            if (locFF >= 0) //FF
-            {
-                allocatorFirstFit.freeFF(locFF);
-                logFree(logFF, currentTime, ev.jobId, locFF);
-            }
+    else if (ev.eventType == 2)
+    { // heap alloc for element
 
-            if (locNF >= 0) //NF
-            {
-                allocatorNextFit.freeFF(locNF);
-                logFree(logNF, currentTime, ev.jobId, locNF);
-            }
+        const HeapElement &element = heapElements[ev.elementId];
 
-            if (locBF >= 0) //BF
-            {
-                allocatorBestFit.freeFF(locBF);
-                logFree(logBF, currentTime, ev.jobId, locBF);
-            }
+        if (config.admissionQueue)
+        {
+            if (!placeHeapElement(state, element, currentTime)) queueRequest(state, element.jobId, element.elementId, element.sizeBytes, currentTime);
+            return;
+        }
 
+        setJobForAlgorithm(state, element.jobId);
+        long long loc = timedMalloc(state, element.sizeBytes, element.lifetime); //lifetime is the hint, known up front here
+        state.heapLocation[element.elementId] = loc;
+        logAllocation(log, currentTime, element.jobId, element.sizeBytes, loc);
+        if (loc >= 0)
+        {
+            state.heapAllocCount++;
+            state.heapAllocBytes += element.sizeBytes;
+        }
+    }
+
+    else if (ev.eventType == 3)
+    {
+        // heap free
+        long long loc = state.heapLocation[ev.elementId];
+
+        if (loc >= 0)
+        {
+            timedFree(state, loc);
+            logFree(log, currentTime, ev.jobId, loc);
+            state.freedSinceRetry = true;
 
-            if (locWF >= 0) //WF
+            const Job &job = jobs[ev.jobId];
+            if (config.jobArenas && currentTime >= job.arrivalTime + job.runTime + state.jobDelay[job.jobId]) //kept orphan, job already gone
             {
-                allocatorWorstFit.freeFF(locWF);
-                logFree(logWF, currentTime, ev.jobId, locWF);
+                state.liveOrphanBytes -= heapElements[ev.elementId].sizeBytes;
             }
-
-            heapLocationFF[ev.elementId] = -1;
-            heapLocationNF[ev.elementId] = -1; //reset to not alloc'd
-            heapLocationBF[ev.elementId] = -1;
-            heapLocationWF[ev.elementId] = -1;
         }
+
+        state.heapLocation[ev.elementId] = -1; //reset to not alloc'd
     }
 }
 
-void MemorySimulation::run()
-{        //reset ALL accumulators and heap stats---------------
-    sampleCount = 0;
-    sumPercentInUseFF = 0;
-    sumPercentInUseNF = 0;
-    sumPercentInUseBF = 0;
-    sumPercentInUseWF = 0;
-    sumPercentInternalFF = 0;
-    sumPercentInternalNF = 0;
-    sumPercentInternalBF = 0;
-    sumPercentInternalWF = 0;
-    maxPercentInUseFF = 0;
-    maxPercentInUseNF = 0;
-    maxPercentInUseBF = 0;
-    maxPercentInUseWF = 0;
-    maxExternalFragFF = 0;
-    maxExternalFragNF = 0;
-    maxExternalFragBF = 0;
-    maxExternalFragWF = 0;
-    heapAllocCountFF = 0;
-    heapAllocCountNF = 0;
-    heapAllocCountBF = 0;
-    heapAllocCountWF = 0;
-    heapAllocBytesFF = 0;
-    heapAllocBytesNF = 0;
-    heapAllocBytesBF = 0;
-    heapAllocBytesWF = 0;
-//---------------------------------------------------------
 
-    buildJobsAndHeapElements();
-    buildEvents();
+// --jobArenas departure: code, stack and heap of the job go in one request,
+// heap elements still alive are orphans, freed now or kept per orphanHeapPolicy
+void MemorySimulation::releaseJobArena(AlgorithmState &state, const Job &job, int currentTime)
+{
+    vector<long long> orphanStarts;
+    long long orphanBytes = 0;
 
+    const vector<int> &elements = jobHeapElements[job.jobId];
+    for (size_t i = 0; i < elements.size(); i++)
+    {
+        long long loc = state.heapLocation[elements[i]];
+        if (loc < 0) continue;
 
-    int lastEventTime = 0;
+        orphanStarts.push_back(loc);
+        orphanBytes += heapElements[elements[i]].sizeBytes;
+    }
 
-     //print inputs
-    cout<<"Configuration:"<< endl;
-    cout<<"Test name: " << config.testName<< endl;
-    cout<<"Seed: "<< config.seed << endl;
-    cout<<"Percent small jobs: "<< config.percentSmall<< endl;
-    cout<<"Percent medium jobs: " << config.percentMedium<< endl;
-    cout<<"Percent large jobs: " << config.percentLarge <<endl;
-    cout<<"Memory unit size (in bytes): " << config.memoryUnitSize<< endl;
-    cout<<"Memory unit count: " << config.memoryUnitCount<< endl;
-    cout<<"Prefill time: 2000" << endl; //hard coded value
-    cout<<"Sampling interval: 200"<< endl;
-    cout<<endl;
+    state.orphanHeapElements += (long long)orphanStarts.size();
+    state.orphanHeapBytes += orphanBytes;
 
+    vector<long long> keepStarts;
+    if (config.orphanHeapPolicy == 1)
+    {
+        keepStarts = orphanStarts;
+        state.liveOrphanBytes += orphanBytes;
+        if (state.liveOrphanBytes > state.peakLiveOrphanBytes) state.peakLiveOrphanBytes = state.liveOrphanBytes;
+    }
 
+    vector<long long> releasedStarts;
+    timedFreeJobArena(state, job.jobId, keepStarts, releasedStarts);
 
-    if (!events.empty()) lastEventTime = events[(int)events.size() - 1].time;
+    for (size_t i = 0; i < releasedStarts.size(); i++) logFree(*state.log, currentTime, job.jobId, releasedStarts[i]);
 
+    if (config.orphanHeapPolicy == 0)
+    {
+        for (size_t i = 0; i < elements.size(); i++) state.heapLocation[elements[i]] = -1; //their free events become no-ops
+    }
 
-    int prefillTime = 2000;     // keep prefill
-    int endTime = lastEventTime;
-    if (endTime < prefillTime) endTime = prefillTime; // ensure we reach prefill for sampling
+    state.jobCodeLocation[job.jobId] = -1;
+    state.jobStackLocation[job.jobId] = -1;
+}
 
 
+// --admissionQueue -------------------------------------------------------
+// a request that does not fit waits in its algorithm's queue. a waiting
+// arrival holds back the whole job, once admitted it runs that many ticks
+// behind schedule. a waiting heap element only moves its own free, the job
+// keeps going (so it can still free memory) and drops it if it departs first
 
-    CsvWriter summaryWriter(config.summaryFilePath); //csv summary writer
-    vector<string> summaryHeader;
-    summaryHeader.push_back("time");
-    summaryHeader.push_back("algorithm");
-    summaryHeader.push_back("allocatedBytes");
-    summaryHeader.push_back("freeBytes");
-    summaryHeader.push_back("requiredBytes");
-    summaryHeader.push_back("externalFragments");
-    summaryHeader.push_back("percentMemoryInUse");
-    summaryHeader.push_back("percentMemoryFree");
-    summaryHeader.push_back("percentInternalFragmentation");
+void MemorySimulation::dispatchEvent(AlgorithmState &state, const Event &ev, int currentTime)
+{
+    if (state.jobBlocked[ev.jobId])
+    {
+        state.heldEvents[ev.jobId].push_back(ev); //replayed on admission
+        return;
+    }
 
-    summaryWriter.header(summaryHeader);
+    int dueTime = ev.time + state.jobDelay[ev.jobId];
+    if (ev.eventType == 3)
+    {
+        if (state.heapWaiting[ev.elementId])
+        {
+            state.heapWaiting[ev.elementId] = 2; //rescheduled on admission
+            return;
+        }
 
+        dueTime += state.heapDelay[ev.elementId];
+    }
 
-    CsvWriter logFF(config.logFileFirstFit);
-    CsvWriter logNF(config.logFileNextFit);    //write for all 4
-    CsvWriter logBF(config.logFileBestFit);
-    CsvWriter logWF(config.logFileWorstFit);
+    if (dueTime > currentTime)
+    {
+        state.deferredEvents.schedule(dueTime, ev);
+        return;
+    }
 
+    processEventForAlgorithm(state, ev, currentTime);
+}
+
+
+void MemorySimulation::runDeferredEvents(AlgorithmState &state, int currentTime)
+{
+    Event ev;
+
+    while (state.deferredEvents.popNext(currentTime, ev))
+    {
+        currentEvent = &ev;
+        dispatchEvent(state, ev, currentTime); //job may have been blocked since
+    }
+
+    currentEvent = nullptr;
+}
+
+
+bool MemorySimulation::placeJob(AlgorithmState &state, const Job &job, int currentTime)
+{
+    setJobForAlgorithm(state, job.jobId);
+    long long nextFitStart = state.allocator.nextFitSearchStart; //the code malloc moves it, a rollback puts it back
+    long long verifyNextFitStart = state.verifyAllocator.nextFitSearchStart;
+    long long locCode = timedMalloc(state, job.codeSize, job.runTime);
+    if (locCode < 0) return false;
+
+    long long locStack = timedMalloc(state, job.stackSize, job.runTime);
+    if (locStack < 0)
+    {
+        // cant run without a stack, take the code malloc back. the workload
+        // never placed or freed it, so it stays out of the allocation and
+        // free request metrics
+        state.allocator.cancelAllocation(locCode, nextFitStart);
+        if (config.verifyEngines && !verifyFailed) state.verifyAllocator.cancelAllocation(locCode, verifyNextFitStart);
+        return false;
+    }
+
+    state.jobCodeLocation[job.jobId] = locCode;
+    state.jobStackLocation[job.jobId] = locStack;
+    logAllocation(*state.log, currentTime, job.jobId, job.codeSize, locCode);
+    logAllocation(*state.log, currentTime, job.jobId, job.stackSize, locStack);
+    return true;
+}
 
-    vector<string> logHeader;
-    logHeader.push_back("time");
-    logHeader.push_back("jobId");
-    logHeader.push_back("event");
-    logHeader.push_back("sizeBytes");
-    logHeader.push_back("location");
 
-    logFF.header(logHeader);
-    logNF.header(logHeader);
-    logBF.header(logHeader);
-    logWF.header(logHeader);
+bool MemorySimulation::placeHeapElement(AlgorithmState &state, const HeapElement &element, int currentTime)
+{
+    setJobForAlgorithm(state, element.jobId);
+    long long loc = timedMalloc(state, element.sizeBytes, element.lifetime);
+    if (loc < 0) return false;
+
+    state.heapLocation[element.elementId] = loc;
+    logAllocation(*state.log, currentTime, element.jobId, element.sizeBytes, loc);
+    state.heapAllocCount++;
+    state.heapAllocBytes += element.sizeBytes;
+    return true;
+}
+
+
+void MemorySimulation::queueRequest(AlgorithmState &state, int jobId, int elementId, int sizeBytes, int currentTime)
+{
+    WaitingRequest request;
+    request.jobId = jobId;
+    request.elementId = elementId;
+    request.queuedTime = currentTime;
 
+    state.waitQueue.push_back(request);
+    if (elementId < 0) state.jobBlocked[jobId] = 1;
+    else state.heapWaiting[elementId] = 1;
+    state.queuedRequests++;
 
+    logQueued(*state.log, currentTime, jobId, sizeBytes);
+}
 
 
-    int sampleInterval=200;
+// every waiting request in queue order, each one that fits now is admitted
+// and its job carries on. held events due this tick run straight away, they
+// can free memory, so go round again until a pass frees nothing
+void MemorySimulation::retryWaitingRequests(AlgorithmState &state, int currentTime)
+{
+    currentEvent = nullptr;
 
-    for (int time = 0; time <= endTime; time++)
+    while (state.freedSinceRetry && !state.waitQueue.empty())
     {
-        processEventsAtTime(time, logFF, logNF, logBF, logWF);
+        state.freedSinceRetry = false;
+
+        vector<WaitingRequest> waiting;
+        waiting.swap(state.waitQueue); //requests queued during the pass land in the fresh one
+        vector<WaitingRequest> stillWaiting;
 
-        if (time >= prefillTime && ((time - prefillTime) % sampleInterval == 0))
+        for (size_t i = 0; i < waiting.size(); i++)
         {
-            // first fit metrics
-            int totalBytesFF = allocatorFirstFit.getTotalMemorySize();
-            int allocatedBytesFF = allocatorFirstFit.getAllocatedMemorySize();
-            int freeBytesFF = allocatorFirstFit.getFreeMemorySize();
-            int requiredBytesFF = allocatorFirstFit.getRequiredMemorySize();
+            const WaitingRequest &request = waiting[i];
 
-            int percentInUseFF = 0;
-            int percentFreeFF = 0;
-            int percentInternalFF = 0;
+            bool placed;
+            if (request.elementId < 0) placed = placeJob(state, jobs[request.jobId], currentTime);
+            else placed = placeHeapElement(state, heapElements[request.elementId], currentTime);
 
-            if (totalBytesFF > 0)
+            if (!placed)
             {
-                percentInUseFF = (100 * allocatedBytesFF) / totalBytesFF;
-                percentFreeFF = (100 * freeBytesFF) / totalBytesFF;
+                stillWaiting.push_back(request);
+                continue;
             }
 
-            int externalFragmentsFF = allocatorFirstFit.getExternalFragmentationCount();
+            int wait = currentTime - request.queuedTime;
+            state.admittedRequests++;
+            state.totalWaitTicks += wait;
+            state.waitHistogram.record(wait);
 
-            if (allocatedBytesFF > 0)
+            if (request.elementId >= 0)
             {
-                int internalWasteFF = allocatedBytesFF - requiredBytesFF;
-                if (internalWasteFF < 0) internalWasteFF = 0;
-
-                percentInternalFF = (100 * internalWasteFF) / allocatedBytesFF;
+                const HeapElement &element = heapElements[request.elementId];
+                bool freeCame = (state.heapWaiting[element.elementId] == 2);
+
+                state.heapDelay[element.elementId] = wait;
+                state.heapWaiting[element.elementId] = 0;
+
+                if (freeCame) //lifetime counts from now
+                {
+                    Event ev;
+                    ev.time = element.getDepartureTime();
+                    ev.jobId = element.jobId;
+                    ev.elementId = element.elementId;
+                    ev.eventType = 3;
+                    dispatchEvent(state, ev, currentTime);
+                }
+                continue;
             }
 
-            //update metrics for FF
-            sumPercentInUseFF += percentInUseFF;
-            sumPercentInternalFF += percentInternalFF;
+            state.jobDelay[request.jobId] += wait;
+            state.jobBlocked[request.jobId] = 0;
+
+            vector<Event> held;
+            held.swap(state.heldEvents[request.jobId]);
 
-            if (percentInUseFF > maxPercentInUseFF) maxPercentInUseFF = percentInUseFF;
+            // deferred and live events can be held out of order
+            stable_sort(held.begin(), held.end(), [](const Event &x, const Event &y)
+            {
+                if (x.time != y.time) return x.time < y.time;
+                return x.eventType < y.eventType;
+            });
 
-            if (externalFragmentsFF > maxExternalFragFF) maxExternalFragFF = externalFragmentsFF;
+            for (size_t h = 0; h < held.size(); h++) dispatchEvent(state, held[h], currentTime);
+        }
 
+        stillWaiting.insert(stillWaiting.end(), state.waitQueue.begin(), state.waitQueue.end()); //older first
+        state.waitQueue.swap(stillWaiting);
+    }
+}
 
-            vector<string> rowFF;
-            rowFF.push_back(to_string(time));
-            rowFF.push_back("FF");
-            rowFF.push_back(to_string(allocatedBytesFF));
-            rowFF.push_back(to_string(freeBytesFF));
-            rowFF.push_back(to_string(requiredBytesFF));
-            rowFF.push_back(to_string(externalFragmentsFF));
-            rowFF.push_back(to_string(percentInUseFF));
-            rowFF.push_back(to_string(percentFreeFF));
-            rowFF.push_back(to_string(percentInternalFF));
-            summaryWriter.row(rowFF);
 
+void MemorySimulation::finishJob(AlgorithmState &state, const Job &job)
+{
+    if (job.runTime <= 0) return;
 
+    int delay = state.jobDelay[job.jobId];
+    long long slowdownPercent = 100LL * (job.runTime + delay) / job.runTime;
 
-            // next fit
-            int totalBytesNF = allocatorNextFit.getTotalMemorySize();
-            int allocatedBytesNF = allocatorNextFit.getAllocatedMemorySize();
-            int freeBytesNF = allocatorNextFit.getFreeMemorySize();
-            int requiredBytesNF = allocatorNextFit.getRequiredMemorySize();
+    state.finishedJobs++;
+    if (delay > 0) state.delayedJobs++;
+    state.sumSlowdownPercent += slowdownPercent;
+    if (slowdownPercent > state.maxSlowdownPercent) state.maxSlowdownPercent = slowdownPercent;
 
-            int percentInUseNF = 0;
-            int percentFreeNF = 0;
-            int percentInternalNF = 0;
+    // heap requests of the job that never got memory go with it
+    vector<WaitingRequest> stillWaiting;
+    for (size_t i = 0; i < state.waitQueue.size(); i++)
+    {
+        const WaitingRequest &request = state.waitQueue[i];
+        if (request.jobId != job.jobId)
+        {
+            stillWaiting.push_back(request);
+            continue;
+        }
 
-            if (totalBytesNF > 0)
-            {
-                percentInUseNF = (100 * allocatedBytesNF) / totalBytesNF;
-                percentFreeNF = (100 * freeBytesNF) / totalBytesNF;
-            }
+        state.heapWaiting[request.elementId] = 0; //its free event finds nothing to free
+        state.abandonedRequests++;
+    }
+    state.waitQueue.swap(stillWaiting);
+}
 
-            int externalFragmentsNF = allocatorNextFit.getExternalFragmentationCount();
 
-            if (allocatedBytesNF > 0)
-            {
-                int internalWasteNF = allocatedBytesNF - requiredBytesNF;
-                if (internalWasteNF < 0) internalWasteNF = 0;
+// --steadyState, memory in use and the share of free memory outside the
+// largest free block, exact rather than the whole percents in summary.csv
+void MemorySimulation::sampleSteadyState(int time)
+{
+    for (size_t a = 0; a < algorithms.size(); a++)
+    {
+        MemoryAllocator &allocator = algorithms[a].allocator;
 
-                percentInternalNF = (100 * internalWasteNF) / allocatedBytesNF;
-            }
+        long long totalBytes = allocator.getTotalMemorySize();
+        long long freeBytes = allocator.getFreeMemorySize();
 
-            //update metrics for NF
-            sumPercentInUseNF += percentInUseNF;
-            sumPercentInternalNF += percentInternalNF;
+        double percentInUse = 0;
+        double percentFragmented = 0;
+        if (totalBytes > 0) percentInUse = 100.0 * allocator.getAllocatedMemorySize() / totalBytes;
+        if (freeBytes > 0) percentFragmented = 100.0 * (freeBytes - allocator.getLargestFreeBlockSize()) / freeBytes;
 
-            if (percentInUseNF > maxPercentInUseNF)  maxPercentInUseNF = percentInUseNF;
+        steadyDetector.addSample((int)a, percentInUse, percentFragmented);
+    }
 
-            if (externalFragmentsNF > maxExternalFragNF) maxExternalFragNF = externalFragmentsNF;
+    steadyDetector.endSampleTime(time);
+}
 
 
-            vector<string> rowNF;
-            rowNF.push_back(to_string(time));
-            rowNF.push_back("NF");
-            rowNF.push_back(to_string(allocatedBytesNF));
-            rowNF.push_back(to_string(freeBytesNF));
-            rowNF.push_back(to_string(requiredBytesNF));
-            rowNF.push_back(to_string(externalFragmentsNF));
-            rowNF.push_back(to_string(percentInUseNF));
-            rowNF.push_back(to_string(percentFreeNF));
-            rowNF.push_back(to_string(percentInternalNF));
-            summaryWriter.row(rowNF);
+void MemorySimulation::setJobForAlgorithm(AlgorithmState &state, int jobId)
+{
+    state.allocator.setCurrentJobId(jobId);
+    if (config.verifyEngines) state.verifyAllocator.setCurrentJobId(jobId);
+}
 
 
-            // best fit
-            int totalBytesBF = allocatorBestFit.getTotalMemorySize();
-            int allocatedBytesBF = allocatorBestFit.getAllocatedMemorySize();
-            int freeBytesBF = allocatorBestFit.getFreeMemorySize();
-            int requiredBytesBF = allocatorBestFit.getRequiredMemorySize();
+long long MemorySimulation::timedMalloc(AlgorithmState &state, int sizeBytes, int lifetimeHint)
+{
+    if (config.verifyEngines && !verifyFailed)
+    {
+        long long location = state.allocator.mallocByType(sizeBytes, lifetimeHint);
+        long long otherLocation = state.verifyAllocator.mallocByType(sizeBytes, lifetimeHint);
 
-            int percentInUseBF = 0;
-            int percentFreeBF = 0;
-            int percentInternalBF = 0;
+        if (verifyValue(state, "malloc(" + to_string(sizeBytes) + ") location", location, otherLocation))
+        {
+            verifyValue(state, "allocationOperationCount", state.allocator.allocationOperationCount, state.verifyAllocator.allocationOperationCount);
+        }
+        return location;
+    }
 
-            if (totalBytesBF > 0)
-            {
-                percentInUseBF = (100 * allocatedBytesBF) / totalBytesBF;
-                percentFreeBF = (100 * freeBytesBF) / totalBytesBF;
-            }
+    if (!profiler.enabled) return state.allocator.mallocByType(sizeBytes, lifetimeHint);
 
-            int externalFragmentsBF = allocatorBestFit.getExternalFragmentationCount();
+    PerfCounterValues countersBefore = perfCounters.read(); //zeros if not available
+    long long start = Profiler::nowNanoseconds();
+    long long location = state.allocator.mallocByType(sizeBytes, lifetimeHint);
+    state.mallocNanoseconds += Profiler::nowNanoseconds() - start;
+    state.mallocCalls++;
 
-            if (allocatedBytesBF > 0)
-            {
-                int internalWasteBF = allocatedBytesBF - requiredBytesBF;
-                if (internalWasteBF < 0) internalWasteBF = 0;
+    if (perfCounters.available) state.mallocCounters.add(countersBefore, perfCounters.read());
 
-                percentInternalBF = (100 * internalWasteBF) / allocatedBytesBF;
-            }
+    return location;
+}
 
-            //update metrics for BF
-            sumPercentInUseBF += percentInUseBF;
-            sumPercentInternalBF += percentInternalBF;
 
-            if (percentInUseBF > maxPercentInUseBF) maxPercentInUseBF = percentInUseBF;
+void MemorySimulation::timedMallocBatch(AlgorithmState &state, const vector<long long> &sizes, const vector<int> &jobIds, const vector<int> &lifetimeHints, vector<long long> &locations)
+{
+    if (config.verifyEngines && !verifyFailed)
+    {
+        // other engine goes one request at a time, so this also checks batch == sequential
+        state.allocator.mallocBatch(sizes, jobIds, lifetimeHints, locations);
 
-            if (externalFragmentsBF > maxExternalFragBF) maxExternalFragBF = externalFragmentsBF;
+        for (size_t r = 0; r < sizes.size(); r++)
+        {
+            state.verifyAllocator.setCurrentJobId(jobIds[r]);
+            long long otherLocation = state.verifyAllocator.mallocByType(sizes[r], lifetimeHints[r]);
 
+            if (!verifyValue(state, "batch malloc(" + to_string(sizes[r]) + ") location", locations[r], otherLocation)) return;
+        }
 
-            vector<string> rowBF;
-            rowBF.push_back(to_string(time));
-            rowBF.push_back("BF");
-            rowBF.push_back(to_string(allocatedBytesBF));
-            rowBF.push_back(to_string(freeBytesBF));
-            rowBF.push_back(to_string(requiredBytesBF));
-            rowBF.push_back(to_string(externalFragmentsBF));
-            rowBF.push_back(to_string(percentInUseBF));
-            rowBF.push_back(to_string(percentFreeBF));
-            rowBF.push_back(to_string(percentInternalBF));
-            summaryWriter.row(rowBF);
+        verifyValue(state, "allocationOperationCount", state.allocator.allocationOperationCount, state.verifyAllocator.allocationOperationCount);
+        return;
+    }
 
+    if (!profiler.enabled)
+    {
+        state.allocator.mallocBatch(sizes, jobIds, lifetimeHints, locations);
+        return;
+    }
 
-            // worst fit
-            int totalBytesWF = allocatorWorstFit.getTotalMemorySize();
-            int allocatedBytesWF = allocatorWorstFit.getAllocatedMemorySize();
-            int freeBytesWF = allocatorWorstFit.getFreeMemorySize();
-            int requiredBytesWF = allocatorWorstFit.getRequiredMemorySize();
+    PerfCounterValues countersBefore = perfCounters.read();
+    long long start = Profiler::nowNanoseconds();
+    state.allocator.mallocBatch(sizes, jobIds, lifetimeHints, locations);
+    state.mallocNanoseconds += Profiler::nowNanoseconds() - start;
+    state.mallocCalls += (long long)sizes.size();
 
-            int percentInUseWF = 0;
-            int percentFreeWF = 0;
-            int percentInternalWF = 0;
+    if (perfCounters.available) state.mallocCounters.add(countersBefore, perfCounters.read());
+}
 
-            if (totalBytesWF > 0)
-            {
-                percentInUseWF = (100 * allocatedBytesWF) / totalBytesWF;
-                percentFreeWF = (100 * freeBytesWF) / totalBytesWF;
-            }
 
-            int externalFragmentsWF = allocatorWorstFit.getExternalFragmentationCount();
+void MemorySimulation::timedFreeJobArena(AlgorithmState &state, int jobId, const vector<long long> &keepStarts, vector<long long> &releasedStarts)
+{
+    if (config.verifyEngines && !verifyFailed)
+    {
+        vector<long long> otherReleased;
+        state.allocator.freeJobArena(jobId, keepStarts, releasedStarts);
+        state.verifyAllocator.freeJobArena(jobId, keepStarts, otherReleased);
 
-            if (allocatedBytesWF > 0)
-            {
-                int internalWasteWF = allocatedBytesWF - requiredBytesWF;
-                if (internalWasteWF < 0) internalWasteWF = 0;
+        if (verifyValue(state, "arena " + to_string(jobId) + " blocks released", (long long)releasedStarts.size(), (long long)otherReleased.size()))
+        {
+            verifyValue(state, "arena " + to_string(jobId) + " freeOperationCount", state.allocator.freeOperationCount, state.verifyAllocator.freeOperationCount);
+        }
+        return;
+    }
 
-                percentInternalWF = (100 * internalWasteWF) / allocatedBytesWF;
-            }
+    if (!profiler.enabled)
+    {
+        state.allocator.freeJobArena(jobId, keepStarts, releasedStarts);
+        return;
+    }
+
+    PerfCounterValues countersBefore = perfCounters.read();
+    long long start = Profiler::nowNanoseconds();
+    state.allocator.freeJobArena(jobId, keepStarts, releasedStarts);
+    state.freeNanoseconds += Profiler::nowNanoseconds() - start;
+    state.freeCalls++;
 
-            //update metrics for WF
-            sumPercentInUseWF += percentInUseWF;
-            sumPercentInternalWF += percentInternalWF;
+    if (perfCounters.available) state.freeCounters.add(countersBefore, perfCounters.read());
+}
+
+
+void MemorySimulation::timedFree(AlgorithmState &state, long long location)
+{
+    if (config.verifyEngines && !verifyFailed)
+    {
+        state.allocator.freeFF(location);
+        state.verifyAllocator.freeFF(location);
+
+        verifyValue(state, "free(" + to_string(location) + ") freeOperationCount", state.allocator.freeOperationCount, state.verifyAllocator.freeOperationCount);
+        return;
+    }
+
+    if (!profiler.enabled)
+    {
+        state.allocator.freeFF(location);
+        return;
+    }
+
+    PerfCounterValues countersBefore = perfCounters.read();
+    long long start = Profiler::nowNanoseconds();
+    state.allocator.freeFF(location);
+    state.freeNanoseconds += Profiler::nowNanoseconds() - start;
+    state.freeCalls++;
+
+    if (perfCounters.available) state.freeCounters.add(countersBefore, perfCounters.read());
+}
+
+
+// --verify, compare one value between engines, first mismatch stops checking
+bool MemorySimulation::verifyValue(AlgorithmState &state, const string &what, long long expected, long long actual)
+{
+    verifyCheckCount++;
+    if (expected == actual) return true;
+
+    MemoryAllocator &scanner = (state.allocator.engineType == 0) ? state.allocator : state.verifyAllocator;
+    MemoryAllocator &candidate = (state.allocator.engineType == 0) ? state.verifyAllocator : state.allocator;
+    long long scannerValue = (state.allocator.engineType == 0) ? expected : actual;
+    long long candidateValue = (state.allocator.engineType == 0) ? actual : expected;
+
+    string text;
+    text += "Verify: engines diverged for " + state.shortName + " at time " + to_string(currentEventTime) + "\n";
+
+    if (currentEvent)
+    {
+        text += "  event type " + to_string(currentEvent->eventType) + " (0=job arrive 1=job depart 2=heap alloc 3=heap free)";
+        text += ", job " + to_string(currentEvent->jobId) + ", heap element " + to_string(currentEvent->elementId) + "\n";
+    }
+
+    text += "  " + what + ": scanner " + to_string(scannerValue) + ", indexed " + to_string(candidateValue) + "\n";
+    text += "  next fit start: scanner " + to_string(scanner.nextFitSearchStart) + ", indexed " + to_string(candidate.nextFitSearchStart) + "\n";
+    text += "  free blocks: scanner " + to_string(scanner.getExternalFragmentationCount()) + ", indexed " + to_string(candidate.getExternalFragmentationCount()) + "\n";
+    text += "  allocations so far: " + to_string(scanner.getNumberOfAllocations()) + ", checks passed before this: " + to_string(verifyCheckCount - 1) + "\n";
+
+    verifyFailed = true;
+    verifyMessage = text;
+    return false;
+}
+
+
+void MemorySimulation::verifySample(AlgorithmState &state, int time)
+{
+    MemoryAllocator &a = state.allocator;
+    MemoryAllocator &b = state.verifyAllocator;
+
+    currentEvent = nullptr; //sample, not an event
+    currentEventTime = time;
+
+    if (!verifyValue(state, "allocated bytes", a.getAllocatedMemorySize(), b.getAllocatedMemorySize())) return;
+    if (!verifyValue(state, "free bytes", a.getFreeMemorySize(), b.getFreeMemorySize())) return;
+    if (!verifyValue(state, "required bytes", a.getRequiredMemorySize(), b.getRequiredMemorySize())) return;
+    if (!verifyValue(state, "external fragments", a.getExternalFragmentationCount(), b.getExternalFragmentationCount())) return;
+    if (!verifyValue(state, "largest free block", a.getLargestFreeBlockSize(), b.getLargestFreeBlockSize())) return;
+    if (!verifyValue(state, "smallest free block", a.getSmallestFreeBlockSize(), b.getSmallestFreeBlockSize())) return;
+    if (!verifyValue(state, "allocation operations", a.getNumberOfAllocationOperations(), b.getNumberOfAllocationOperations())) return;
+    if (!verifyValue(state, "free operations", a.getNumberOfFreeOperations(), b.getNumberOfFreeOperations())) return;
+
+    // owner of the first and last unit of every live block, catches a run map out of step
+    for (map<long long, long long>::iterator it = a.activeRecordByStart.begin(); it != a.activeRecordByStart.end(); ++it)
+    {
+        long long start = it->first;
+        long long last = start + a.allocations[it->second].unitCount - 1;
+        if (last >= a.memoryUnitCount) last = a.memoryUnitCount - 1;
+
+        if (!verifyValue(state, "owner of unit " + to_string(start), a.getUnitJobId(start), b.getUnitJobId(start))) return;
+        if (!verifyValue(state, "owner of unit " + to_string(last), a.getUnitJobId(last), b.getUnitJobId(last))) return;
+    }
+}
+
+
+// free block sizes for one algorithm at a sample time, read off the size
+// classes of the free block index (kept on both engines with the histogram
+// on), no unit walk
+void MemorySimulation::sampleFreeBlocks(AlgorithmState &state, int time, CsvWriter &writer)
+{
+    MemoryAllocator &allocator = state.allocator;
+    FreeBlockIndex &blocks = allocator.getFreeBlocks();
+
+    long long requiredUnits = 1;
+    if (allocator.memoryUnitSize > 0 && config.usableRequestBytes > 0) requiredUnits = (config.usableRequestBytes + allocator.memoryUnitSize - 1) / allocator.memoryUnitSize;
+
+    long long freeUnits = blocks.getFreeUnits();
+    long long usableUnits = blocks.getUsableUnits(requiredUnits);
+
+    long long usablePercentX100 = 0;
+    if (freeUnits > 0) usablePercentX100 = usableUnits * 10000 / freeUnits;
+
+    vector<string> row;
+    row.push_back(to_string(time));
+    row.push_back(state.shortName);
+    row.push_back(to_string(blocks.getBlockCount()));
+    row.push_back(to_string(freeUnits * allocator.memoryUnitSize));
+    row.push_back(to_string(usableUnits * allocator.memoryUnitSize));
+    row.push_back(to_string(usablePercentX100));
+
+    int lastClass = FreeBlockIndex::sizeClassOf(allocator.memoryUnitCount);
+    for (int k = 0; k <= lastClass; k++) row.push_back(to_string(blocks.classBlocks[k]));
+
+    writer.row(row);
+}
+
+
+// metrics for one algorithm at a sample time, one row in summary.csv
+void MemorySimulation::sampleAlgorithm(AlgorithmState &state, int time, CsvWriter &summaryWriter)
+{
+    MemoryAllocator &allocator = state.allocator;
+
+    long long totalBytes = allocator.getTotalMemorySize();
+    long long allocatedBytes = allocator.getAllocatedMemorySize();
+    long long freeBytes = allocator.getFreeMemorySize();
+    long long requiredBytes = allocator.getRequiredMemorySize();
+
+    int percentInUse = 0;
+    int percentFree = 0;
+    int percentInternal = 0;
+
+    if (totalBytes > 0)
+    {
+        percentInUse = percentOf(allocatedBytes, totalBytes);
+        percentFree = percentOf(freeBytes, totalBytes);
+    }
+
+    long long externalFragments = allocator.getExternalFragmentationCount();
+
+    if (allocatedBytes > 0)
+    {
+        long long internalWaste = allocatedBytes - requiredBytes;
+        if (internalWaste < 0) internalWaste = 0;
+
+        percentInternal = percentOf(internalWaste, allocatedBytes);
+    }
+
+    if (config.verifyEngines && !verifyFailed) verifySample(state, time);
+
+    //update running metrics
+    state.sumPercentInUse += percentInUse;
+    state.sumPercentInternal += percentInternal;
+
+    if (percentInUse > state.maxPercentInUse) state.maxPercentInUse = percentInUse;
+
+    if (externalFragments > state.maxExternalFrag) state.maxExternalFrag = externalFragments;
+
+
+    vector<string> row;
+    row.push_back(to_string(time));
+    row.push_back(state.shortName);
+    row.push_back(to_string(allocatedBytes));
+    row.push_back(to_string(freeBytes));
+    row.push_back(to_string(requiredBytes));
+    row.push_back(to_string(externalFragments));
+    row.push_back(to_string(percentInUse));
+    row.push_back(to_string(percentFree));
+    row.push_back(to_string(percentInternal));
+
+    OperationHistogram &allocHistogram = allocator.allocationSearchHistogram;
+    OperationHistogram &freeHistogram = allocator.freeSearchHistogram;
+    row.push_back(to_string(allocHistogram.percentile(50)));
+    row.push_back(to_string(allocHistogram.percentile(90)));
+    row.push_back(to_string(allocHistogram.percentile(99)));
+    row.push_back(to_string(allocHistogram.percentile(99.9)));
+    row.push_back(to_string(allocHistogram.getMax()));
+    row.push_back(to_string(freeHistogram.percentile(50)));
+    row.push_back(to_string(freeHistogram.percentile(90)));
+    row.push_back(to_string(freeHistogram.percentile(99)));
+    row.push_back(to_string(freeHistogram.percentile(99.9)));
+    row.push_back(to_string(freeHistogram.getMax()));
+    if (config.admissionQueue) row.push_back(to_string(state.waitQueue.size()));
+    summaryWriter.row(row);
+}
+
+
+static const string checkpointMagic = "MSIMCKP6";
+
+
+static void writeEvent(BinaryWriter &out, const MemorySimulation::Event &ev)
+{
+    out.writeInt(ev.time);
+    out.writeInt(ev.jobId);
+    out.writeInt(ev.elementId);
+    out.writeInt(ev.eventType);
+}
+
+static MemorySimulation::Event readEvent(BinaryReader &in)
+{
+    MemorySimulation::Event ev;
+    ev.time = (int)in.readInt();
+    ev.jobId = (int)in.readInt();
+    ev.elementId = (int)in.readInt();
+    ev.eventType = (int)in.readInt();
+    return ev;
+}
+
+
+// everything a later run needs to carry on after time as if it never stopped
+// profiling numbers are left out, they belong to the process that measured them
+bool MemorySimulation::saveCheckpoint(const string &path, int time)
+{
+    BinaryWriter out;
+    out.writeString(checkpointMagic);
+    out.writeInt(time);
+
+    out.writeInt(config.seed);
+    out.writeInt(config.percentSmall);
+    out.writeInt(config.percentMedium);
+    out.writeInt(config.percentLarge);
+    out.writeInt(config.memoryUnitSize);
+    out.writeInt(config.memoryUnitCount);
+    out.writeInt(config.arrivalHorizon);
+    out.writeInt(config.maxHeapElements);
+    out.writeInt(config.prefillTime);
+    out.writeInt(config.sampleInterval);
+
+    rng.saveState(out);
+
+    out.writeInt((long long)jobs.size());
+    for (size_t i = 0; i < jobs.size(); i++)
+    {
+        const Job &job = jobs[i];
+        out.writeInt(job.jobId);
+        out.writeInt(job.jobType);
+        out.writeInt(job.arrivalTime);
+        out.writeInt(job.runTime);
+        out.writeInt(job.codeSize);
+        out.writeInt(job.stackSize);
+        out.writeInt(job.heapElementCount);
+    }
+
+    out.writeInt((long long)heapElements.size());
+    for (size_t i = 0; i < heapElements.size(); i++)
+    {
+        const HeapElement &element = heapElements[i];
+        out.writeInt(element.elementId);
+        out.writeInt(element.jobId);
+        out.writeInt(element.arrivalTime);
+        out.writeInt(element.lifetime);
+        out.writeInt(element.sizeBytes);
+    }
 
-            if (percentInUseWF > maxPercentInUseWF) maxPercentInUseWF = percentInUseWF;
+    calendar.saveState(out); //whats still to come
 
-            if (externalFragmentsWF > maxExternalFragWF) maxExternalFragWF = externalFragmentsWF;
+    // --jobModel coroutine, the job source and which jobs are live. frames
+    // cant be written out, on load each live job restarts at the next tick
+    out.writeInt(config.jobModel);
+    out.writeInt(jobSourceActive ? 1 : 0);
+    out.writeInt(jobSourceBaseTime);
+    out.writeInt(jobSourceNextArrival);
+    out.writeInt((long long)liveJobs.size());
+    for (size_t i = 0; i < liveJobs.size(); i++) out.writeInt(liveJobs[i].jobId);
 
+    out.writeInt(config.steadyState ? 1 : 0);
+    steadyDetector.saveState(out);
 
-            vector<string> rowWF;
-            rowWF.push_back(to_string(time));
-            rowWF.push_back("WF");
-            rowWF.push_back(to_string(allocatedBytesWF));
-            rowWF.push_back(to_string(freeBytesWF));
-            rowWF.push_back(to_string(requiredBytesWF));
-            rowWF.push_back(to_string(externalFragmentsWF));
-            rowWF.push_back(to_string(percentInUseWF));
-            rowWF.push_back(to_string(percentFreeWF));
-            rowWF.push_back(to_string(percentInternalWF));
-            summaryWriter.row(rowWF);
+    out.writeInt(sampleCount);
+    out.writeInt(logEventSequence);
 
+    out.writeInt((long long)algorithms.size());
+    for (size_t a = 0; a < algorithms.size(); a++)
+    {
+        AlgorithmState &state = algorithms[a];
+        out.writeString(state.shortName);
+        state.allocator.saveState(out);
+
+        out.writeIntVector(state.jobCodeLocation);
+        out.writeIntVector(state.jobStackLocation);
+        out.writeIntVector(state.heapLocation);
+
+        out.writeInt(state.heapAllocCount);
+        out.writeInt(state.heapAllocBytes);
+        out.writeInt(state.sumPercentInUse);
+        out.writeInt(state.sumPercentInternal);
+        out.writeInt(state.maxPercentInUse);
+        out.writeInt(state.maxExternalFrag);
+        out.writeInt(state.orphanHeapElements);
+        out.writeInt(state.orphanHeapBytes);
+        out.writeInt(state.liveOrphanBytes);
+        out.writeInt(state.peakLiveOrphanBytes);
+
+        // admission queue, all empty when it is off
+        out.writeInt((long long)state.waitQueue.size());
+        for (size_t i = 0; i < state.waitQueue.size(); i++)
+        {
+            out.writeInt(state.waitQueue[i].jobId);
+            out.writeInt(state.waitQueue[i].elementId);
+            out.writeInt(state.waitQueue[i].queuedTime);
+        }
 
-            sampleCount++;
+        out.writeIntVector(vector<long long>(state.jobDelay.begin(), state.jobDelay.end()));
+        out.writeIntVector(vector<long long>(state.jobBlocked.begin(), state.jobBlocked.end()));
+        out.writeIntVector(vector<long long>(state.heapDelay.begin(), state.heapDelay.end()));
+        out.writeIntVector(vector<long long>(state.heapWaiting.begin(), state.heapWaiting.end()));
 
+        long long heldCount = 0;
+        for (size_t j = 0; j < state.heldEvents.size(); j++) heldCount += (long long)state.heldEvents[j].size();
+        out.writeInt(heldCount);
+        for (size_t j = 0; j < state.heldEvents.size(); j++)
+        {
+            for (size_t i = 0; i < state.heldEvents[j].size(); i++) writeEvent(out, state.heldEvents[j][i]); //jobId says whose
         }
 
+        state.deferredEvents.saveState(out);
+
+        out.writeInt(state.freedSinceRetry ? 1 : 0);
+        out.writeInt(state.queuedRequests);
+        out.writeInt(state.admittedRequests);
+        out.writeInt(state.abandonedRequests);
+        state.waitHistogram.saveState(out);
+        out.writeInt(state.totalWaitTicks);
+        out.writeInt(state.queueLengthSum);
+        out.writeInt(state.queueTicks);
+        out.writeInt(state.peakQueueLength);
+        out.writeInt(state.finishedJobs);
+        out.writeInt(state.delayedJobs);
+        out.writeInt(state.sumSlowdownPercent);
+        out.writeInt(state.maxSlowdownPercent);
     }
 
-    // final summary for each algorithm
-    //FF
-    int totalBytesFF = allocatorFirstFit.getTotalMemorySize();
-    int allocatedBytesFF = allocatorFirstFit.getAllocatedMemorySize();
-    int freeBytesFF = allocatorFirstFit.getFreeMemorySize();
-    int requiredBytesFF = allocatorFirstFit.getRequiredMemorySize();
-    int largestFreeBlockBytesFF = allocatorFirstFit.getLargestFreeBlockSize();
-    int smallestFreeBlockBytesFF = allocatorFirstFit.getSmallestFreeBlockSize();
+    return out.saveToFile(path);
+}
 
-    int numAllocFF = allocatorFirstFit.getNumberOfAllocations();
-    int numAllocOpsFF = allocatorFirstFit.getNumberOfAllocationOperations();
-    int numFreeFF = allocatorFirstFit.getNumberOfFreeRequests();
-    int numFreeOpsFF = allocatorFirstFit.getNumberOfFreeOperations();
 
-    int percentInUseFF = 0;
-    int percentFreeFF = 0;
-    int percentInternalFF = 0;
+// replaces the workload and memory config with the snapshot's, engine,
+// ownership map, logging and reporting stay whatever this run asked for
+bool MemorySimulation::loadCheckpoint(const string &path, int &resumeTime)
+{
+    BinaryReader in;
+    if (!in.loadFromFile(path)) return false;
+    if (in.readString() != checkpointMagic) return false;
+
+    int time = (int)in.readInt();
+
+    config.seed = (unsigned)in.readInt();
+    config.percentSmall = (int)in.readInt();
+    config.percentMedium = (int)in.readInt();
+    config.percentLarge = (int)in.readInt();
+    config.memoryUnitSize = (int)in.readInt();
+    config.memoryUnitCount = in.readInt();
+    config.arrivalHorizon = (int)in.readInt();
+    config.maxHeapElements = (int)in.readInt();
+    config.prefillTime = (int)in.readInt();
+    config.sampleInterval = (int)in.readInt();
+    if (!in.ok) return false;
+
+    initializeAllocators(); //memory size may differ from the command line
+    if (!rng.loadState(in)) return false;
+
+    long long jobCount = in.readInt();
+    jobs.clear();
+    for (long long i = 0; i < jobCount && in.ok; i++)
+    {
+        Job job;
+        job.jobId = (int)in.readInt();
+        job.jobType = (char)in.readInt();
+        job.arrivalTime = (int)in.readInt();
+        job.runTime = (int)in.readInt();
+        job.codeSize = (int)in.readInt();
+        job.stackSize = (int)in.readInt();
+        job.heapElementCount = (int)in.readInt();
+        jobs.push_back(job);
+    }
 
-    if (totalBytesFF > 0)
+    long long heapCount = in.readInt();
+    heapElements.clear();
+    for (long long i = 0; i < heapCount && in.ok; i++)
     {
-        percentInUseFF = (100 * allocatedBytesFF) / totalBytesFF;
-        percentFreeFF = (100 * freeBytesFF) / totalBytesFF;
+        HeapElement element;
+        element.elementId = (int)in.readInt();
+        element.jobId = (int)in.readInt();
+        element.arrivalTime = (int)in.readInt();
+        element.lifetime = (int)in.readInt();
+        element.sizeBytes = (int)in.readInt();
+        heapElements.push_back(element);
     }
 
-    if (allocatedBytesFF > 0)
+    if (!calendar.loadState(in)) return false;
+
+    config.jobModel = (int)in.readInt();
+    jobSourceActive = (in.readInt() != 0);
+    jobSourceBaseTime = (int)in.readInt();
+    jobSourceNextArrival = (int)in.readInt();
+
+    vector<int> liveJobIds;
+    long long liveCount = in.readInt();
+    for (long long i = 0; i < liveCount && in.ok; i++) liveJobIds.push_back((int)in.readInt());
+
+    config.steadyState = (in.readInt() != 0); //warm up already decided by the snapshot
+    if (!steadyDetector.loadState(in)) return false;
+
+    sampleCount = (int)in.readInt();
+    logEventSequence = in.readInt();
+
+    long long algorithmCount = in.readInt();
+    if (!in.ok || algorithmCount != (long long)algorithms.size()) return false;
+
+    for (size_t a = 0; a < algorithms.size(); a++)
     {
-        int internalWasteFF = allocatedBytesFF - requiredBytesFF;
-        if (internalWasteFF < 0) internalWasteFF = 0;
+        AlgorithmState &state = algorithms[a];
+        if (in.readString() != state.shortName) return false;
+
+        size_t allocatorPosition = in.position;
+        if (!state.allocator.loadState(in)) return false;
+        if (config.verifyEngines)
+        {
+            in.position = allocatorPosition; //same state into the other engine
+            if (!state.verifyAllocator.loadState(in)) return false;
+        }
+
+        state.jobCodeLocation = in.readIntVector();
+        state.jobStackLocation = in.readIntVector();
+        state.heapLocation = in.readIntVector();
+
+        state.heapAllocCount = in.readInt();
+        state.heapAllocBytes = in.readInt();
+        state.sumPercentInUse = in.readInt();
+        state.sumPercentInternal = in.readInt();
+        state.maxPercentInUse = in.readInt();
+        state.maxExternalFrag = in.readInt();
+        state.orphanHeapElements = in.readInt();
+        state.orphanHeapBytes = in.readInt();
+        state.liveOrphanBytes = in.readInt();
+        state.peakLiveOrphanBytes = in.readInt();
+
+        long long waitingCount = in.readInt();
+        state.waitQueue.clear();
+        for (long long i = 0; i < waitingCount && in.ok; i++)
+        {
+            WaitingRequest request;
+            request.jobId = (int)in.readInt();
+            request.elementId = (int)in.readInt();
+            request.queuedTime = (int)in.readInt();
+            state.waitQueue.push_back(request);
+        }
+
+        vector<long long> delays = in.readIntVector();
+        vector<long long> blocked = in.readIntVector();
+        if (!in.ok || delays.size() != jobs.size() || blocked.size() != jobs.size()) return false;
+        state.jobDelay.assign(delays.begin(), delays.end());
+        state.jobBlocked.assign(blocked.begin(), blocked.end());
+
+        vector<long long> heapDelays = in.readIntVector();
+        vector<long long> heapWaits = in.readIntVector();
+        if (!in.ok || heapDelays.size() != heapElements.size() || heapWaits.size() != heapElements.size()) return false;
+        state.heapDelay.assign(heapDelays.begin(), heapDelays.end());
+        state.heapWaiting.assign(heapWaits.begin(), heapWaits.end());
+
+        long long heldCount = in.readInt();
+        state.heldEvents.assign(jobs.size(), vector<Event>());
+        for (long long i = 0; i < heldCount && in.ok; i++)
+        {
+            Event ev = readEvent(in);
+            if (ev.jobId < 0 || ev.jobId >= (int)jobs.size()) return false;
+            state.heldEvents[ev.jobId].push_back(ev);
+        }
 
-        percentInternalFF = (100 * internalWasteFF) / allocatedBytesFF;
+        if (!state.deferredEvents.loadState(in)) return false;
+
+        state.freedSinceRetry = (in.readInt() != 0);
+        state.queuedRequests = in.readInt();
+        state.admittedRequests = in.readInt();
+        state.abandonedRequests = in.readInt();
+        if (!state.waitHistogram.loadState(in)) return false;
+        state.totalWaitTicks = in.readInt();
+        state.queueLengthSum = in.readInt();
+        state.queueTicks = in.readInt();
+        state.peakQueueLength = in.readInt();
+        state.finishedJobs = in.readInt();
+        state.delayedJobs = in.readInt();
+        state.sumSlowdownPercent = in.readInt();
+        state.maxSlowdownPercent = in.readInt();
     }
 
+    if (!in.ok) return false;
 
-    // averages over all sampled times
-    int avgPercentInUseFF = 0;
-    int avgPercentInternalFF = 0;
+    indexJobHeapElements();
 
-    if (sampleCount > 0)
+    liveJobs.clear();
+    for (size_t i = 0; i < liveJobIds.size(); i++)
     {
-        avgPercentInUseFF = sumPercentInUseFF / sampleCount;
-        avgPercentInternalFF = sumPercentInternalFF / sampleCount;
+        if (liveJobIds[i] < 0 || liveJobIds[i] >= (int)jobs.size()) return false;
+        liveJobs.push_back(startJobProcess(jobs[liveJobIds[i]], time + 1));
     }
 
-    int avgAllocOpsFF = 0;
-    int avgFreeOpsFF = 0;
+    resumeTime = time + 1;
+    return true;
+}
 
-    if (numAllocFF > 0) avgAllocOpsFF = numAllocOpsFF / numAllocFF;
 
-    if (numFreeFF > 0) avgFreeOpsFF = numFreeOpsFF / numFreeFF;
+void MemorySimulation::run()
+{        //reset ALL accumulators and heap stats---------------
+    sampleCount = 0;
+    processedEventCount = 0;
+    for (size_t a = 0; a < algorithms.size(); a++) algorithms[a].resetCounters();
+    logEventSequence = 0;
+    logSampledEvent = true;
+    verifyCheckCount = 0;
+    verifyFailed = false;
+    verifyMessage = "";
+    checkpointFailed = false;
+
+    profiler.reset();
+    profiler.enabled = config.profile || config.perfCounters; //wall clock is the fallback
+    if (config.perfCounters) perfCounters.open(); //quietly stays off if the kernel says no
+    int phaseBuildJobs = profiler.phaseIndex("buildJobsAndHeapElements");
+    int phaseBuildEvents = profiler.phaseIndex("buildEvents");
+    int phaseTickLoop = profiler.phaseIndex("tickLoop");
+    int phaseSampling = profiler.phaseIndex("metricSampling");
+    int phaseClose = profiler.phaseIndex("csvWriterClose");
+//---------------------------------------------------------
 
+    int startTime = 0;
 
+    if (!config.checkpointLoadPath.empty()) //warm state, skip generation and the ticks already done
+    {
+        ScopedTimer timer(profiler, profiler.phaseIndex("checkpointLoad"));
 
-    // extra efficiency metrics
-    int totalOperationsFF = numAllocOpsFF + numFreeOpsFF;
-    int operationsPerTimeFF = 0;
-    int totalTimeSteps = endTime + 1;
-    if (totalTimeSteps > 0) operationsPerTimeFF = totalOperationsFF / totalTimeSteps;
+        if (!loadCheckpoint(config.checkpointLoadPath, startTime))
+        {
+            message("Error: could not load checkpoint " + config.checkpointLoadPath + "\n");
+            checkpointFailed = true;
+            return;
+        }
+    }
+    else if (config.jobModel == 1) //jobs get made and emit events as the ticks go
+    {
+        startJobSource();
+        liveJobs.clear();
+        calendar.reset(0);
+    }
+    else
+    {
+        {
+            ScopedTimer timer(profiler, phaseBuildJobs);
+            if (sharedWorkload) adoptWorkload(*sharedWorkload);
+            else buildJobsAndHeapElements();
+        }
+
+        {
+            ScopedTimer timer(profiler, phaseBuildEvents);
+            buildEvents();
+        }
+    }
 
 
+    int lastEventTime = 0;
 
+     //print inputs, built first so its one write
+    string configText;
+    configText += "Configuration:\n";
+    configText += "Test name: " + config.testName + "\n";
+    configText += "Seed: " + to_string(config.seed) + "\n";
+    configText += "Percent small jobs: " + to_string(config.percentSmall) + "\n";
+    configText += "Percent medium jobs: " + to_string(config.percentMedium) + "\n";
+    configText += "Percent large jobs: " + to_string(config.percentLarge) + "\n";
+    configText += "Memory unit size (in bytes): " + to_string(config.memoryUnitSize) + "\n";
+    configText += "Memory unit count: " + to_string(config.memoryUnitCount) + "\n";
+    configText += "Arrival horizon: " + to_string(config.arrivalHorizon) + "\n";
+    if (config.steadyState) configText += "Prefill time: until steady state\n";
+    else configText += "Prefill time: " + to_string(config.prefillTime) + "\n";
+    configText += "Sampling interval: " + to_string(config.sampleInterval) + "\n";
+    if (config.jobModel == 1) configText += "Job model: coroutine\n";
+    if (config.admissionQueue) configText += "Admission queue: on\n";
+    if (config.lifetimeAware) configText += "Lifetime aware threshold: " + to_string(config.lifetimeThreshold) + "\n";
+    if (startTime > 0) configText += "Resumed from checkpoint, continuing at time: " + to_string(startTime) + "\n";
+    configText += "\n";
 
-    cout<<"Final statistics for First Fit:" << endl;
-    cout<<"Total memory bytes: " << totalBytesFF << endl;
-    cout<<"Allocated bytes:    " << allocatedBytesFF << endl;
-    cout<<"Free bytes:   " << freeBytesFF << endl;
-    cout<< "Required bytes: " << requiredBytesFF << endl;
-    cout<< "Percent memory in use: " << percentInUseFF << endl;
-    cout<< "Percent memory free: " << percentFreeFF << endl;
-    cout<< "Percent internal fragmentation: " << percentInternalFF << endl;
-    cout<< "Average percent memory in use (over samples): " << avgPercentInUseFF << endl;
-    cout<< "Average percent internal fragmentation (over samples): " << avgPercentInternalFF << endl;
-    cout<< "Peak percent memory in use: " << maxPercentInUseFF << endl;
-    cout<< "Peak external fragmentation (free blocks): " << maxExternalFragFF << endl;
-    cout<< "Largest free block (bytes): " << largestFreeBlockBytesFF << endl;
-    cout<< "Smallest free block (bytes): " << smallestFreeBlockBytesFF << endl;
-    cout<< "Number of heap allocations: " << heapAllocCountFF << endl;
-    cout<< "Total memory size of heap elements: " << heapAllocBytesFF << endl;
-    cout<< "Number of allocations: " << numAllocFF << endl;
-    cout << "Number of allocation operations: " << numAllocOpsFF << endl;
-    cout<< "Average allocation operations: " << avgAllocOpsFF << endl;
-    cout<< "Number of free requests: " << numFreeFF << endl;
-    cout<< "Number of free operations: " << numFreeOpsFF << endl;
-    cout<< "Average free operations: " << avgFreeOpsFF << endl;
-    cout<< "Total allocation+free operations: " << totalOperationsFF << endl;
-    cout<<"Operations per time unit: " << operationsPerTimeFF << endl;
-    cout << endl;
+    if (config.textReport) cout << configText;
 
 
 
+    if (calendar.getLastTime() > 0) lastEventTime = calendar.getLastTime();
 
 
-    //NF
-    int totalBytesNF = allocatorNextFit.getTotalMemorySize();
-    int allocatedBytesNF = allocatorNextFit.getAllocatedMemorySize();
-    int freeBytesNF = allocatorNextFit.getFreeMemorySize();
-    int requiredBytesNF = allocatorNextFit.getRequiredMemorySize();
-    int largestFreeBlockBytesNF = allocatorNextFit.getLargestFreeBlockSize();
-    int smallestFreeBlockBytesNF = allocatorNextFit.getSmallestFreeBlockSize();
+    int prefillTime = config.prefillTime;
+    int endTime = lastEventTime;
+    if (endTime < prefillTime) endTime = prefillTime; // ensure we reach prefill for sampling
 
-    int numAllocNF = allocatorNextFit.getNumberOfAllocations();
-    int numAllocOpsNF = allocatorNextFit.getNumberOfAllocationOperations();
-    int numFreeNF = allocatorNextFit.getNumberOfFreeRequests();
-    int numFreeOpsNF = allocatorNextFit.getNumberOfFreeOperations();
+    int checkpointTime = (config.checkpointTime >= 0) ? config.checkpointTime : prefillTime;
 
-    int percentInUseNF = 0;
-    int percentFreeNF = 0;
-    int percentInternalNF = 0;
 
-    if (totalBytesNF > 0)
+
+    if (!config.timeSeriesFilePath.empty())
     {
-        percentInUseNF = (100 * allocatedBytesNF) / totalBytesNF;
-        percentFreeNF = (100 * freeBytesNF) / totalBytesNF;
+        vector<string> seriesNames;
+        for (size_t a = 0; a < algorithms.size(); a++) seriesNames.push_back(algorithms[a].shortName);
+
+        if (timeSeries.open(config.timeSeriesFilePath, seriesNames)) recordTimeSeries(startTime); //starting point
+        else message("Warning: could not write time series " + config.timeSeriesFilePath + "\n");
     }
 
-    if (allocatedBytesNF > 0)
+    int heatmapInterval = (config.heatmapInterval > 0) ? config.heatmapInterval : 1;
+    if (!config.heatmapFilePrefix.empty())
     {
-        int internalWasteNF = allocatedBytesNF - requiredBytesNF;
-        if (internalWasteNF < 0) internalWasteNF = 0;
+        for (size_t a = 0; a < algorithms.size(); a++) algorithms[a].heatmap.configure(config.memoryUnitCount, config.heatmapRows, config.heatmapMaxColumns);
+    }
 
-        percentInternalNF = (100 * internalWasteNF) / allocatedBytesNF;
+    unique_ptr<CsvWriter> freeBlockWriter; // --freeBlockHistogram
+    if (!config.freeBlockFilePath.empty())
+    {
+        freeBlockWriter = make_unique<CsvWriter>(config.freeBlockFilePath);
+
+        vector<string> freeBlockHeader;
+        freeBlockHeader.push_back("time");
+        freeBlockHeader.push_back("algorithm");
+        freeBlockHeader.push_back("freeBlocks");
+        freeBlockHeader.push_back("freeBytes");
+        freeBlockHeader.push_back("usableBytes"); //in blocks that fit usableRequestBytes
+        freeBlockHeader.push_back("usablePercentX100");
+        int lastClass = FreeBlockIndex::sizeClassOf(config.memoryUnitCount);
+        for (int k = 0; k <= lastClass; k++) freeBlockHeader.push_back("blocks" + to_string(1LL << k)); //2^k to 2^(k+1)-1 units
+        freeBlockWriter->header(freeBlockHeader);
     }
 
-    // averages over all sampled times
-    int avgPercentInUseNF = 0;
-    int avgPercentInternalNF = 0;
+    CsvWriter summaryWriter(config.summaryFilePath); //csv summary writer
+    vector<string> summaryHeader;
+    summaryHeader.push_back("time");
+    summaryHeader.push_back("algorithm");
+    summaryHeader.push_back("allocatedBytes");
+    summaryHeader.push_back("freeBytes");
+    summaryHeader.push_back("requiredBytes");
+    summaryHeader.push_back("externalFragments");
+    summaryHeader.push_back("percentMemoryInUse");
+    summaryHeader.push_back("percentMemoryFree");
+    summaryHeader.push_back("percentInternalFragmentation");
+    summaryHeader.push_back("allocOpsP50"); //search cost percentiles so far
+    summaryHeader.push_back("allocOpsP90");
+    summaryHeader.push_back("allocOpsP99");
+    summaryHeader.push_back("allocOpsP999");
+    summaryHeader.push_back("allocOpsMax");
+    summaryHeader.push_back("freeOpsP50");
+    summaryHeader.push_back("freeOpsP90");
+    summaryHeader.push_back("freeOpsP99");
+    summaryHeader.push_back("freeOpsP999");
+    summaryHeader.push_back("freeOpsMax");
+    if (config.admissionQueue) summaryHeader.push_back("queueLength");
 
-    if (sampleCount > 0)
+    summaryWriter.header(summaryHeader);
+
+
+    vector<string> logHeader;
+    logHeader.push_back("time");
+    logHeader.push_back("jobId");
+    logHeader.push_back("event");
+    logHeader.push_back("sizeBytes");
+    logHeader.push_back("location");
+
+    vector<unique_ptr<CsvWriter>> logWriters; //one per algorithm
+    for (size_t a = 0; a < algorithms.size(); a++)
     {
-        avgPercentInUseNF = sumPercentInUseNF / sampleCount;
-        avgPercentInternalNF = sumPercentInternalNF / sampleCount;
+        logWriters.push_back(make_unique<CsvWriter>(algorithms[a].logFilePath, config.asyncLogWriter));
+        logWriters[a]->header(logHeader);
+        algorithms[a].log = logWriters[a].get();
     }
 
-    int avgAllocOpsNF = 0;
-    int avgFreeOpsNF = 0;
 
-    if (numAllocNF > 0) avgAllocOpsNF = numAllocOpsNF / numAllocNF;
 
-    if (numFreeNF > 0) avgFreeOpsNF = numFreeOpsNF / numFreeNF;
 
+    int sampleInterval = config.sampleInterval;
+    if (sampleInterval <= 0) sampleInterval = 1;
 
-    // extra efficiency metrics
-    int totalOperationsNF = numAllocOpsNF + numFreeOpsNF;
-    int operationsPerTimeNF = 0;
-    if (totalTimeSteps > 0) operationsPerTimeNF = totalOperationsNF / totalTimeSteps;
-
-
-
-    cout <<"Final statistics for Next Fit:" << endl;
-    cout <<"Total memory bytes: " << totalBytesNF << endl;
-    cout <<"Allocated bytes: " << allocatedBytesNF << endl;
-    cout <<"Free bytes: " << freeBytesNF << endl;
-    cout <<"Required bytes: " << requiredBytesNF << endl;
-    cout <<"Percent memory in use: " << percentInUseNF << endl;
-    cout <<"Percent memory free: " << percentFreeNF << endl;
-    cout <<"Percent internal fragmentation: " << percentInternalNF << endl;
-    cout <<"Average percent memory in use (over samples): " << avgPercentInUseNF << endl;
-    cout <<"Average percent internal fragmentation (over samples): " << avgPercentInternalNF << endl;
-    cout <<"Peak percent memory in use: " << maxPercentInUseNF << endl;
-    cout <<"Peak external fragmentation (free blocks): " << maxExternalFragNF << endl;
-    cout <<"Largest free block (bytes): " << largestFreeBlockBytesNF << endl;
-    cout <<"Smallest free block (bytes): " << smallestFreeBlockBytesNF << endl;
-    cout <<"Number of heap allocations: " << heapAllocCountNF << endl;
-    cout <<"Total memory size of heap elements: " << heapAllocBytesNF << endl;
-    cout <<"Number of allocations: " << numAllocNF << endl;
-    cout <<"Number of allocation operations: " << numAllocOpsNF << endl;
-    cout <<"Average allocation operations: " << avgAllocOpsNF << endl;
-    cout <<"Number of free requests: " << numFreeNF << endl;
-    cout <<"Number of free operations: " << numFreeOpsNF << endl;
-    cout <<"Average free operations: " << avgFreeOpsNF << endl;
-    cout <<"Total allocation+free operations: " << totalOperationsNF << endl;
-    cout <<"Operations per time unit: " << operationsPerTimeNF << endl;
-    cout << endl;
-
-
-    //BF
-    int totalBytesBF = allocatorBestFit.getTotalMemorySize();
-    int allocatedBytesBF = allocatorBestFit.getAllocatedMemorySize();
-    int freeBytesBF = allocatorBestFit.getFreeMemorySize();
-    int requiredBytesBF = allocatorBestFit.getRequiredMemorySize();
-    int largestFreeBlockBytesBF = allocatorBestFit.getLargestFreeBlockSize();
-    int smallestFreeBlockBytesBF = allocatorBestFit.getSmallestFreeBlockSize();
-
-    int numAllocBF = allocatorBestFit.getNumberOfAllocations();
-    int numAllocOpsBF = allocatorBestFit.getNumberOfAllocationOperations();
-    int numFreeBF = allocatorBestFit.getNumberOfFreeRequests();
-    int numFreeOpsBF = allocatorBestFit.getNumberOfFreeOperations();
-
-    int percentInUseBF = 0;
-    int percentFreeBF = 0;
-    int percentInternalBF = 0;
-
-    if (totalBytesBF > 0)
-    {
-        percentInUseBF = (100 * allocatedBytesBF) / totalBytesBF;
-        percentFreeBF = (100 * freeBytesBF) / totalBytesBF;
-    }
-
-    if (allocatedBytesBF > 0)
-    {
-        int internalWasteBF = allocatedBytesBF - requiredBytesBF;
-        if (internalWasteBF < 0) internalWasteBF = 0;
-
-        percentInternalBF = (100 * internalWasteBF) / allocatedBytesBF;
+    if (config.steadyState && startTime == 0) steadyDetector.configure((int)algorithms.size(), config.steadyWindow, config.steadyTolerance, config.steadyHalfWidth);
+    bool stoppedEarly = false;
+
+    int phaseJobProcesses = (config.jobModel == 1) ? profiler.phaseIndex("jobProcesses") : -1; //once, not per tick
+
+    long long tickLoopStart = Profiler::nowNanoseconds();
+    {
+        ScopedTimer loopTimer(profiler, phaseTickLoop);
+
+        for (int time = startTime; time <= endTime; time++)
+        {
+            if (config.jobModel == 1)
+            {
+                ScopedTimer timer(profiler, phaseJobProcesses);
+                advanceJobProcesses(time);
+
+                if (jobSourceActive || !liveJobs.empty()) endTime = max(endTime, time + 1); //end not known up front
+            }
+
+            processEventsAtTime(time);
+
+            if (!config.heatmapFilePrefix.empty() && (time - startTime) % heatmapInterval == 0)
+            {
+                ScopedTimer timer(profiler, phaseSampling);
+                for (size_t a = 0; a < algorithms.size(); a++) algorithms[a].heatmap.addSample(algorithms[a].allocator.getFreeBlocks()); //kept in step, no unit walk
+            }
+
+            if (config.steadyState && time % sampleInterval == 0)
+            {
+                ScopedTimer timer(profiler, phaseSampling);
+                sampleSteadyState(time);
+            }
+
+            int samplingStart = config.steadyState ? steadyDetector.getSteadyTime() : prefillTime; //-1 while warming up
+            if (samplingStart >= 0 && time >= samplingStart && ((time - samplingStart) % sampleInterval == 0))
+            {
+                ScopedTimer timer(profiler, phaseSampling);
+
+                for (size_t a = 0; a < algorithms.size(); a++) sampleAlgorithm(algorithms[a], time, summaryWriter);
+                if (freeBlockWriter) for (size_t a = 0; a < algorithms.size(); a++) sampleFreeBlocks(algorithms[a], time, *freeBlockWriter);
+
+                sampleCount++;
+            }
+
+            if (time == checkpointTime && !config.checkpointSavePath.empty())
+            {
+                ScopedTimer timer(profiler, profiler.phaseIndex("checkpointSave"));
+
+                if (!saveCheckpoint(config.checkpointSavePath, time))
+                {
+                    message("Error: could not write checkpoint " + config.checkpointSavePath + "\n");
+                    checkpointFailed = true;
+                }
+            }
+
+            if (config.steadyState && steadyDetector.isConfident()) //more ticks would not tell us more
+            {
+                endTime = time;
+                stoppedEarly = true;
+                break;
+            }
+        }
     }
+    long long tickLoopNanoseconds = Profiler::nowNanoseconds() - tickLoopStart;
+    bool perfCountersUsed = perfCounters.available;
+    perfCounters.close();
 
-    // averages over all sampled times
-    int avgPercentInUseBF = 0;
-    int avgPercentInternalBF = 0;
+    {
+        ScopedTimer timer(profiler, phaseClose);
 
-    if (sampleCount > 0)
+        summaryWriter.close();
+        if (freeBlockWriter) freeBlockWriter->close();
+
+        for (size_t a = 0; a < algorithms.size() && !config.heatmapFilePrefix.empty(); a++)
+        {
+            string heatmapPath = config.heatmapFilePrefix + "_" + algorithms[a].shortName + ".pgm";
+            if (!algorithms[a].heatmap.writePgm(heatmapPath)) message("Warning: could not write heatmap " + heatmapPath + "\n");
+        }
+        for (size_t a = 0; a < logWriters.size(); a++) logWriters[a]->close();
+        timeSeries.close();
+    }
+
+    for (size_t a = 0; a < algorithms.size(); a++) algorithms[a].allocator.unitJobId.sync(); //mapped maps complete on disk
+    for (size_t a = 0; a < algorithms.size(); a++) algorithms[a].allocator.advanceClock(endTime + 1); //last tick held for one tick too
+
+    // final summary for each algorithm
+    int totalTimeSteps = endTime + 1;
+
+    report = SimulationReport();
+    report.testName = config.testName;
+    report.addConfig("seed", (long long)config.seed);
+    report.addConfig("percentSmall", config.percentSmall);
+    report.addConfig("percentMedium", config.percentMedium);
+    report.addConfig("percentLarge", config.percentLarge);
+    report.addConfig("memoryUnitSize", config.memoryUnitSize);
+    report.addConfig("memoryUnitCount", config.memoryUnitCount);
+    report.addConfig("arrivalHorizon", config.arrivalHorizon);
+    report.addConfig("prefillTime", config.steadyState ? steadyDetector.getSteadyTime() : prefillTime);
+    report.addConfig("sampleInterval", sampleInterval);
+    if (config.maxHeapElements != 20000) report.addConfig("maxHeapElements", config.maxHeapElements);
+    if (config.steadyState)
+    {
+        report.addConfig("steadyStateTime", steadyDetector.getSteadyTime()); //-1 = never reached
+        report.addConfig("stoppedEarly", stoppedEarly ? 1 : 0);
+    }
+    report.addConfig("endTime", endTime);
+    if (startTime > 0) report.addConfig("resumedFromTime", startTime);
+    if (config.jobModel == 1) report.addConfig("jobModel", "coroutine");
+    if (config.admissionQueue) report.addConfig("admissionQueue", 1);
+    if (config.lifetimeAware) report.addConfig("lifetimeThreshold", config.lifetimeThreshold);
+    if (!config.freeBlockFilePath.empty()) report.addConfig("usableRequestBytes", config.usableRequestBytes);
+    if (!config.heatmapFilePrefix.empty() && !algorithms.empty()) report.addConfig("heatmapTicksPerColumn", heatmapInterval * algorithms[0].heatmap.samplesPerColumn);
+    if (!config.timeSeriesFilePath.empty())
+    {
+        report.addConfig("timeSeriesRecords", timeSeries.recordCount);
+        report.addConfig("timeSeriesBytes", timeSeries.bytesWritten);
+    }
+
+    for (size_t a = 0; a < algorithms.size(); a++)
+    {
+        report.algorithms.push_back(buildAlgorithmReport(algorithms[a], totalTimeSteps));
+
+        if (config.steadyState)
+        {
+            // memory in use since steady state, batch means and their 95% interval
+            double halfWidth = steadyDetector.getHalfWidth((int)a);
+            report.algorithms[a].add("steadyBatches", "Steady state batches", steadyDetector.getBatchCount((int)a));
+            report.algorithms[a].add("steadyMeanPercentInUseX100", "Steady state mean percent in use x100", llround(steadyDetector.getMean((int)a) * 100));
+            report.algorithms[a].add("steadyHalfWidthX100", "Steady state 95% half width x100 (-1 = too few batches)", (halfWidth < 0) ? -1 : llround(halfWidth * 100));
+        }
+    }
+
+    if (config.steadyState && config.textReport)
     {
-        avgPercentInUseBF = sumPercentInUseBF / sampleCount;
-        avgPercentInternalBF = sumPercentInternalBF / sampleCount;
+        if (!steadyDetector.isSteady()) cout << "Steady state not reached, no samples taken; try a longer --horizon or a larger --steadyTolerance\n";
+        else if (stoppedEarly) cout << "Steady state from time " << steadyDetector.getSteadyTime() << ", confident at time " << endTime << ", stopped early\n";
+        else cout << "Steady state from time " << steadyDetector.getSteadyTime() << ", ran to the end without reaching the requested confidence\n";
     }
 
-    int avgAllocOpsBF = 0;
-    int avgFreeOpsBF = 0;
+    if (profiler.enabled) addProfileReport(report, tickLoopNanoseconds, perfCountersUsed);
 
-    if (numAllocBF > 0) avgAllocOpsBF = numAllocOpsBF / numAllocBF;
+    if (!config.reportFilePath.empty() && !report.writeJson(config.reportFilePath))
+    {
+        message("Warning: could not write report " + config.reportFilePath + "\n");
+    }
 
-    if (numFreeBF > 0) avgFreeOpsBF = numFreeOpsBF / numFreeBF;
+    if (config.textReport) cout << report.toText(); //one write, no per line flush
 
+    for (size_t a = 0; a < algorithms.size(); a++) algorithms[a].log = nullptr; //writers are gone
 
-    // extra efficiency metrics
-    int totalOperationsBF = numAllocOpsBF + numFreeOpsBF;
-    int operationsPerTimeBF = 0;
-    if (totalTimeSteps > 0) operationsPerTimeBF = totalOperationsBF / totalTimeSteps;
+    if (config.verifyEngines)
+    {
+        // end state too, not just the samples
+        for (size_t a = 0; a < algorithms.size() && !verifyFailed; a++) verifySample(algorithms[a], endTime);
 
+        if (verifyFailed) message(verifyMessage);
+        else message("Verify: scanner and indexed engines matched (" + to_string(verifyCheckCount) + " checks)\n");
+    }
 
+    if (config.textReport) cout << "Simulation complete for test: " << config.testName << endl;
+}
 
 
-    cout <<"Final statistics for Best Fit:" << endl;
-    cout<<"Total memory bytes: " << totalBytesBF << endl;
-    cout<<"Allocated bytes: " << allocatedBytesBF << endl;
-    cout <<"Free bytes: " << freeBytesBF << endl;
-    cout <<"Required bytes: " << requiredBytesBF << endl;
-    cout <<"Percent memory in use: " << percentInUseBF << endl;
-    cout <<"Percent memory free: " << percentFreeBF << endl;
-    cout <<"Percent internal fragmentation: " << percentInternalBF << endl;
-    cout <<"Average percent memory in use (over samples): " << avgPercentInUseBF << endl;
-    cout <<"Average percent internal fragmentation (over samples): " << avgPercentInternalBF << endl;
-    cout <<"Peak percent memory in use: " << maxPercentInUseBF << endl;
-    cout <<"Peak external fragmentation (free blocks): " << maxExternalFragBF << endl;
-    cout <<"Largest free block (bytes): " << largestFreeBlockBytesBF << endl;
-    cout <<"Smallest free block (bytes): " << smallestFreeBlockBytesBF << endl;
-    cout <<"Number of heap allocations: " << heapAllocCountBF << endl;
-    cout <<"Total memory size of heap elements: " << heapAllocBytesBF << endl;
-    cout <<"Number of allocations: " << numAllocBF << endl;
-    cout <<"Number of allocation operations: " << numAllocOpsBF << endl;
-    cout <<"Average allocation operations: " << avgAllocOpsBF << endl;
-    cout <<"Number of free requests: " << numFreeBF << endl;
-    cout <<"Number of free operations: " << numFreeOpsBF << endl;
-    cout <<"Average free operations: " << avgFreeOpsBF << endl;
-    cout <<"Total allocation+free operations: " << totalOperationsBF << endl;
-    cout <<"Operations per time unit: " << operationsPerTimeBF << endl;
-    cout << endl;
+void MemorySimulation::message(const string &text)
+{
+    if (printMessages) cout << text;
+    else messages += text;
+}
+
 
+// gather final statistics of one allocator into a report block
+AlgorithmReport MemorySimulation::buildAlgorithmReport(AlgorithmState &state, int totalTimeSteps)
+{
+    MemoryAllocator &allocator = state.allocator;
 
-    //WF
-    int totalBytesWF = allocatorWorstFit.getTotalMemorySize();
-    int allocatedBytesWF = allocatorWorstFit.getAllocatedMemorySize();
-    int freeBytesWF = allocatorWorstFit.getFreeMemorySize();
-    int requiredBytesWF = allocatorWorstFit.getRequiredMemorySize();
-    int largestFreeBlockBytesWF = allocatorWorstFit.getLargestFreeBlockSize();
-    int smallestFreeBlockBytesWF = allocatorWorstFit.getSmallestFreeBlockSize();
+    long long totalBytes = allocator.getTotalMemorySize();
+    long long allocatedBytes = allocator.getAllocatedMemorySize();
+    long long freeBytes = allocator.getFreeMemorySize();
+    long long requiredBytes = allocator.getRequiredMemorySize();
 
-    int numAllocWF = allocatorWorstFit.getNumberOfAllocations();
-    int numAllocOpsWF = allocatorWorstFit.getNumberOfAllocationOperations();
-    int numFreeWF = allocatorWorstFit.getNumberOfFreeRequests();
-    int numFreeOpsWF = allocatorWorstFit.getNumberOfFreeOperations();
+    long long numAlloc = allocator.getNumberOfAllocations();
+    long long numAllocOps = allocator.getNumberOfAllocationOperations();
+    long long numFree = allocator.getNumberOfFreeRequests();
+    long long numFreeOps = allocator.getNumberOfFreeOperations();
 
-    int percentInUseWF = 0;
-    int percentFreeWF = 0;
-    int percentInternalWF = 0;
+    int percentInUse = 0;
+    int percentFree = 0;
+    int percentInternal = 0;
 
-    if (totalBytesWF > 0)
+    if (totalBytes > 0)
     {
-        percentInUseWF = (100 * allocatedBytesWF) / totalBytesWF;
-        percentFreeWF = (100 * freeBytesWF) / totalBytesWF;
+        percentInUse = percentOf(allocatedBytes, totalBytes);
+        percentFree = percentOf(freeBytes, totalBytes);
     }
 
-    if (allocatedBytesWF > 0)
+    if (allocatedBytes > 0)
     {
-        int internalWasteWF = allocatedBytesWF - requiredBytesWF;
-        if (internalWasteWF < 0) internalWasteWF = 0;
+        long long internalWaste = allocatedBytes - requiredBytes;
+        if (internalWaste < 0) internalWaste = 0;
 
-        percentInternalWF = (100 * internalWasteWF) / allocatedBytesWF;
+        percentInternal = percentOf(internalWaste, allocatedBytes);
     }
 
     // averages over all sampled times
-    int avgPercentInUseWF = 0;
-    int avgPercentInternalWF = 0;
+    long long avgPercentInUse = 0;
+    long long avgPercentInternal = 0;
 
     if (sampleCount > 0)
     {
-        avgPercentInUseWF = sumPercentInUseWF / sampleCount;
-        avgPercentInternalWF = sumPercentInternalWF / sampleCount;
+        avgPercentInUse = state.sumPercentInUse / sampleCount;
+        avgPercentInternal = state.sumPercentInternal / sampleCount;
     }
 
-    int avgAllocOpsWF = 0;
-    int avgFreeOpsWF = 0;
+    // exact time weighted averages over the whole run, [0, endTime]
+    long long ticks = allocator.clockTime;
+    long long timeAvgAllocated = 0;
+    long long timeAvgRequired = 0;
+    long long timeAvgFree = 0;
+    long long timeAvgFreeBlocksX100 = 0;
+    long long timeAvgPercentInUseX100 = 0;
+    long long timeAvgPercentInternalX100 = 0;
+
+    if (ticks > 0)
+    {
+        double allocatedByteTicks = (double)allocator.allocatedUnitTicks * allocator.memoryUnitSize;
+        double totalByteTicks = (double)totalBytes * ticks;
+
+        timeAvgAllocated = llround(allocatedByteTicks / ticks);
+        timeAvgRequired = llround((double)allocator.requiredByteTicks / ticks);
+        timeAvgFree = llround((totalByteTicks - allocatedByteTicks) / ticks);
+        timeAvgFreeBlocksX100 = llround(100.0 * allocator.freeBlockTicks / ticks);
 
-    if (numAllocWF > 0) avgAllocOpsWF = numAllocOpsWF / numAllocWF;
+        if (totalByteTicks > 0) timeAvgPercentInUseX100 = llround(10000.0 * allocatedByteTicks / totalByteTicks);
+        if (allocatedByteTicks > 0) timeAvgPercentInternalX100 = llround(10000.0 * (allocatedByteTicks - allocator.requiredByteTicks) / allocatedByteTicks);
+    }
 
-    if (numFreeWF > 0) avgFreeOpsWF = numFreeOpsWF / numFreeWF;
+    long long avgAllocOps = 0;
+    long long avgFreeOps = 0;
 
+    if (numAlloc > 0) avgAllocOps = numAllocOps / numAlloc;
 
+    if (numFree > 0) avgFreeOps = numFreeOps / numFree;
 
     // extra efficiency metrics
-    int totalOperationsWF = numAllocOpsWF + numFreeOpsWF;
-    int operationsPerTimeWF = 0;
-    if (totalTimeSteps > 0) operationsPerTimeWF = totalOperationsWF / totalTimeSteps;
-
-
-
-
-    cout << "Final statistics for Worst Fit:" << endl;
-    cout << "Total memory bytes: " << totalBytesWF << endl;
-    cout << "Allocated bytes: " << allocatedBytesWF << endl;
-    cout << "Free bytes: " << freeBytesWF << endl;
-    cout << "Required bytes: " << requiredBytesWF << endl;
-    cout << "Percent memory in use: " << percentInUseWF << endl;
-    cout << "Percent memory free: " << percentFreeWF << endl;
-    cout << "Percent internal fragmentation:  " << percentInternalWF << endl;
-    cout << "Average percent memory in use (over samples):  " << avgPercentInUseWF << endl;
-    cout << "Average percent internal fragmentation (over samples): " << avgPercentInternalWF << endl;
-    cout << "Peak percent memory in use: " << maxPercentInUseWF << endl;
-    cout << "Peak external fragmentation (free blocks): " << maxExternalFragWF << endl;
-    cout << "Largest free block (bytes): " << largestFreeBlockBytesWF << endl;
-    cout << "Smallest free block (bytes):  " << smallestFreeBlockBytesWF << endl;
-    cout << "Number of heap allocations: " << heapAllocCountWF << endl;
-    cout << "Total memory size of heap elements: " << heapAllocBytesWF << endl;
-    cout << "Number of allocations: " << numAllocWF << endl;
-    cout << "Number of allocation operations: " << numAllocOpsWF << endl;
-    cout << "Average allocation operations: " << avgAllocOpsWF << endl;
-    cout << "Number of free requests: " << numFreeWF << endl;
-    cout <<"Number of free operations: " <<numFreeOpsWF << endl;
-    cout << "Average free operations: " << avgFreeOpsWF << endl;
-    cout << "Total allocation+free operations: " << totalOperationsWF << endl;
-    cout << "Operations per time unit: "<< operationsPerTimeWF <<endl;
-    cout <<bendl;
-
-
-
-    //TABLE
-    cout <<"Overall Comparison Table (per algorithm)" << endl;
-    cout <<"Metric,FF,NF,BF,WF" << endl;
-
-    cout <<"Total memory bytes,"
-         <<totalBytesFF << ","
-         <<totalBytesNF << ","
-         <<totalBytesBF << ","
-         <<totalBytesWF << endl;
-
-    cout <<"Allocated bytes,"
-         <<allocatedBytesFF << ","
-         <<allocatedBytesNF << ","
-         <<allocatedBytesBF << ","
-         <<allocatedBytesWF << endl;
-
-    cout <<"Free bytes,"
-         <<freeBytesFF << ","
-         <<freeBytesNF << ","
-         <<freeBytesBF << ","
-         <<freeBytesWF << endl;
-
-    cout <<"Required bytes,"
-         <<requiredBytesFF << ","
-         <<requiredBytesNF << ","
-         <<requiredBytesBF << ","
-         <<requiredBytesWF << endl;
-
-    cout <<"Percent memory in use,"
-         <<percentInUseFF << ","
-         <<percentInUseNF << ","
-         <<percentInUseBF << ","
-         <<percentInUseWF << endl;
-
-    cout <<"Percent memory free,"
-         <<percentFreeFF << ","
-         <<percentFreeNF << ","
-         <<percentFreeBF << ","
-         <<percentFreeWF << endl;
-
-    cout <<"Percent internal fragmentation,"
-         <<percentInternalFF << ","
-         <<percentInternalNF << ","
-         <<percentInternalBF << ","
-         <<percentInternalWF << endl;
-
-    cout <<"Average percent memory in use (samples),"
-         <<avgPercentInUseFF << ","
-         <<avgPercentInUseNF << ","
-         <<avgPercentInUseBF << ","
-         <<avgPercentInUseWF << endl;
-
-    cout <<"Average percent internal fragmentation (samples),"
-         <<avgPercentInternalFF << ","
-         <<avgPercentInternalNF << ","
-         <<avgPercentInternalBF << ","
-         <<avgPercentInternalWF << endl;
-
-    cout << "Peak percent memory in use,"
-         <<maxPercentInUseFF << ","
-         <<maxPercentInUseNF << ","
-         <<maxPercentInUseBF << ","
-         <<maxPercentInUseWF << endl;
-
-    cout <<"Peak external fragmentation (free blocks),"
-         <<maxExternalFragFF << ","
-         <<maxExternalFragNF << ","
-         <<maxExternalFragBF << ","
-         << maxExternalFragWF << endl;
-
-    cout <<"Largest free block (bytes),"
-         <<largestFreeBlockBytesFF << ","
-         <<largestFreeBlockBytesNF << ","
-         <<largestFreeBlockBytesBF << ","
-         <<largestFreeBlockBytesWF << endl;
-
-    cout <<"Smallest free block (bytes),"
-         <<smallestFreeBlockBytesFF << ","
-         <<smallestFreeBlockBytesNF << ","
-         <<smallestFreeBlockBytesBF << ","
-         <<smallestFreeBlockBytesWF << endl;
-
-    cout <<"Number of heap allocations,"
-         <<heapAllocCountFF << ","
-         <<heapAllocCountNF << ","
-         <<heapAllocCountBF << ","
-         <<heapAllocCountWF << endl;
-
-    cout << "Total memory size of heap elements,"
-         << heapAllocBytesFF << ","
-         << heapAllocBytesNF << ","
-         << heapAllocBytesBF << ","
-         << heapAllocBytesWF << endl;
-
-    cout <<"Number of allocations,"
-         <<numAllocFF << ","
-         <<numAllocNF << ","
-         <<numAllocBF << ","
-         <<numAllocWF << endl;
-
-    cout <<"Number of allocation operations,"
-         <<numAllocOpsFF << ","
-         <<numAllocOpsNF << ","
-         <<numAllocOpsBF << ","
-         <<numAllocOpsWF << endl;
-
-    cout <<"Average allocation operations,"
-         <<avgAllocOpsFF << ","
-         <<avgAllocOpsNF << ","
-         <<avgAllocOpsBF << ","
-         <<avgAllocOpsWF << endl;
-
-    cout << "Number of free requests,"
-         <<numFreeFF << ","
-         <<numFreeNF << ","
-         <<numFreeBF << ","
-         <<numFreeWF << endl;
-
-    cout << "Number of free operations,"
-         <<numFreeOpsFF << ","
-         <<numFreeOpsNF << ","
-         <<numFreeOpsBF << ","
-         <<numFreeOpsWF << endl;
-
-    cout << "Average free operations,"
-         <<avgFreeOpsFF << ","
-         <<avgFreeOpsNF << ","
-         <<avgFreeOpsBF << ","
-         <<avgFreeOpsWF << endl;
-
-    cout <<"Total allocation+free operations,"
-         <<totalOperationsFF << ","
-         <<totalOperationsNF << ","
-         <<totalOperationsBF << ","
-         <<totalOperationsWF << endl;
-
-    cout <<"Operations per time unit,"
-         <<operationsPerTimeFF << ","
-         <<operationsPerTimeNF << ","
-         <<operationsPerTimeBF << ","
-         <<operationsPerTimeWF << endl;
-
-    cout<<endl;
-
-
-
-    summaryWriter.close();
-    logFF.close();
-    logNF.close();
-    logBF.close();
-    logWF.close();
-
-    cout << "Simulation complete for test: " << config.testName <<endl;
+    long long totalOperations = numAllocOps + numFreeOps;
+    long long operationsPerTime = 0;
+    if (totalTimeSteps > 0) operationsPerTime = totalOperations / totalTimeSteps;
+
+
+    AlgorithmReport report;
+    report.name = allocator.algorithmName;
+    report.shortName = state.shortName;
+
+    report.add("totalBytes", "Total memory bytes", totalBytes);
+    report.add("allocatedBytes", "Allocated bytes", allocatedBytes);
+    report.add("freeBytes", "Free bytes", freeBytes);
+    report.add("requiredBytes", "Required bytes", requiredBytes);
+    report.add("percentMemoryInUse", "Percent memory in use", percentInUse);
+    report.add("percentMemoryFree", "Percent memory free", percentFree);
+    report.add("percentInternalFragmentation", "Percent internal fragmentation", percentInternal);
+    report.add("avgPercentMemoryInUse", "Average percent memory in use (over samples)", avgPercentInUse);
+    report.add("avgPercentInternalFragmentation", "Average percent internal fragmentation (over samples)", avgPercentInternal);
+    report.add("timeAvgAllocatedBytes", "Time weighted average allocated bytes", timeAvgAllocated);
+    report.add("timeAvgRequiredBytes", "Time weighted average required bytes", timeAvgRequired);
+    report.add("timeAvgFreeBytes", "Time weighted average free bytes", timeAvgFree);
+    report.add("timeAvgFreeBlocksX100", "Time weighted average free blocks x100", timeAvgFreeBlocksX100);
+    report.add("timeAvgPercentMemoryInUseX100", "Time weighted average percent memory in use x100", timeAvgPercentInUseX100);
+    report.add("timeAvgPercentInternalFragmentationX100", "Time weighted average percent internal fragmentation x100", timeAvgPercentInternalX100);
+    report.add("peakPercentMemoryInUse", "Peak percent memory in use", state.maxPercentInUse);
+    report.add("peakExternalFragments", "Peak external fragmentation (free blocks)", state.maxExternalFrag);
+    report.add("largestFreeBlockBytes", "Largest free block (bytes)", allocator.getLargestFreeBlockSize());
+    report.add("smallestFreeBlockBytes", "Smallest free block (bytes)", allocator.getSmallestFreeBlockSize());
+    report.add("heapAllocations", "Number of heap allocations", state.heapAllocCount);
+    report.add("heapAllocatedBytes", "Total memory size of heap elements", state.heapAllocBytes);
+    report.add("allocations", "Number of allocations", numAlloc);
+    report.add("allocationOperations", "Number of allocation operations", numAllocOps);
+    report.add("avgAllocationOperations", "Average allocation operations", avgAllocOps);
+    report.add("allocationOperationsP50", "Allocation operations p50", allocator.allocationSearchHistogram.percentile(50));
+    report.add("allocationOperationsP90", "Allocation operations p90", allocator.allocationSearchHistogram.percentile(90));
+    report.add("allocationOperationsP99", "Allocation operations p99", allocator.allocationSearchHistogram.percentile(99));
+    report.add("allocationOperationsP999", "Allocation operations p99.9", allocator.allocationSearchHistogram.percentile(99.9));
+    report.add("allocationOperationsMax", "Allocation operations max", allocator.allocationSearchHistogram.getMax());
+    report.add("freeRequests", "Number of free requests", numFree);
+    report.add("freeOperations", "Number of free operations", numFreeOps);
+    report.add("avgFreeOperations", "Average free operations", avgFreeOps);
+    report.add("freeOperationsP50", "Free operations p50", allocator.freeSearchHistogram.percentile(50));
+    report.add("freeOperationsP90", "Free operations p90", allocator.freeSearchHistogram.percentile(90));
+    report.add("freeOperationsP99", "Free operations p99", allocator.freeSearchHistogram.percentile(99));
+    report.add("freeOperationsP999", "Free operations p99.9", allocator.freeSearchHistogram.percentile(99.9));
+    report.add("freeOperationsMax", "Free operations max", allocator.freeSearchHistogram.getMax());
+    report.add("totalOperations", "Total allocation+free operations", totalOperations);
+    report.add("operationsPerTimeUnit", "Operations per time unit", operationsPerTime);
+
+    if (config.jobArenas)
+    {
+        report.add("orphanHeapElements", "Heap elements alive when their job departed", state.orphanHeapElements);
+        report.add("orphanHeapBytes", "Bytes of heap alive when their job departed", state.orphanHeapBytes);
+        report.add("peakLiveOrphanBytes", "Peak orphan bytes kept past their job", state.peakLiveOrphanBytes);
+    }
+
+    if (config.admissionQueue)
+    {
+        long long avgWaitTicks = 0;
+        long long avgQueueLengthX100 = 0;
+        long long avgSlowdownPercent = 0;
+
+        if (state.admittedRequests > 0) avgWaitTicks = state.totalWaitTicks / state.admittedRequests;
+        if (state.queueTicks > 0) avgQueueLengthX100 = (state.queueLengthSum * 100) / state.queueTicks;
+        if (state.finishedJobs > 0) avgSlowdownPercent = state.sumSlowdownPercent / state.finishedJobs;
+
+        report.add("queuedRequests", "Requests that had to wait", state.queuedRequests);
+        report.add("admittedRequests", "Waiting requests admitted", state.admittedRequests);
+        report.add("abandonedRequests", "Heap requests dropped when their job departed", state.abandonedRequests);
+        report.add("stillWaitingRequests", "Requests still waiting at the end", (long long)state.waitQueue.size());
+        report.add("avgQueueLengthX100", "Average queue length x100 (over ticks)", avgQueueLengthX100);
+        report.add("peakQueueLength", "Peak queue length", state.peakQueueLength);
+        report.add("avgWaitTicks", "Average wait (ticks)", avgWaitTicks);
+        report.add("waitTicksP50", "Wait p50 (ticks)", state.waitHistogram.percentile(50));
+        report.add("waitTicksP90", "Wait p90 (ticks)", state.waitHistogram.percentile(90));
+        report.add("waitTicksP99", "Wait p99 (ticks)", state.waitHistogram.percentile(99));
+        report.add("waitTicksMax", "Wait max (ticks)", state.waitHistogram.getMax());
+        report.add("finishedJobs", "Jobs finished", state.finishedJobs);
+        report.add("delayedJobs", "Jobs finished late", state.delayedJobs);
+        report.add("avgJobSlowdownPercent", "Average job slowdown (percent of run time, 100 = on time)", avgSlowdownPercent);
+        report.add("maxJobSlowdownPercent", "Max job slowdown (percent of run time)", state.maxSlowdownPercent);
+    }
+
+    return report;
 }
 
 
+
+
+
+// --profile, phase timings plus per algorithm throughput
+void MemorySimulation::addProfileReport(SimulationReport &report, long long tickLoopNanoseconds, bool perfCountersUsed)
+{
+    for (size_t i = 0; i < profiler.phases.size(); i++)
+    {
+        const PhaseTiming &phase = profiler.phases[i];
+        report.addProfile(phase.name + "Nanoseconds", "Time in " + phase.name + " (ns)", phase.nanoseconds);
+    }
+
+    report.addProfile("processedEvents", "Events processed", processedEventCount);
+    report.addProfile("perfCountersAvailable", "Hardware counters available", perfCountersUsed ? 1 : 0);
+
+    long long eventsPerSecond = 0;
+    if (tickLoopNanoseconds > 0) eventsPerSecond = (processedEventCount * 1000000000LL) / tickLoopNanoseconds;
+    report.addProfile("eventsPerSecond", "Events per second (tick loop)", eventsPerSecond);
+
+
+    for (size_t a = 0; a < algorithms.size() && a < report.algorithms.size(); a++)
+    {
+        AlgorithmState &state = algorithms[a];
+        AlgorithmReport &algorithmReport = report.algorithms[a];
+
+        long long nsPerMalloc = 0;
+        long long nsPerFree = 0;
+        long long algorithmEventsPerSecond = 0;
+
+        if (state.mallocCalls > 0) nsPerMalloc = state.mallocNanoseconds / state.mallocCalls;
+        if (state.freeCalls > 0) nsPerFree = state.freeNanoseconds / state.freeCalls;
+        if (state.eventNanoseconds > 0) algorithmEventsPerSecond = (processedEventCount * 1000000000LL) / state.eventNanoseconds;
+
+        algorithmReport.add("profileEventNanoseconds", "Time processing events (ns)", state.eventNanoseconds);
+        algorithmReport.add("profileEventsPerSecond", "Events per second", algorithmEventsPerSecond);
+        algorithmReport.add("profileMallocCalls", "Malloc calls", state.mallocCalls);
+        algorithmReport.add("profileNanosecondsPerMalloc", "Nanoseconds per malloc", nsPerMalloc);
+        algorithmReport.add("profileFreeCalls", "Free calls", state.freeCalls);
+        algorithmReport.add("profileNanosecondsPerFree", "Nanoseconds per free", nsPerFree);
+
+        if (!perfCountersUsed) continue;
+
+        // hardware counters split into malloc and free phases
+        algorithmReport.add("perfMallocCycles", "Malloc cycles", state.mallocCounters.cycles);
+        algorithmReport.add("perfMallocInstructions", "Malloc instructions", state.mallocCounters.instructions);
+        algorithmReport.add("perfMallocCacheMisses", "Malloc cache misses", state.mallocCounters.cacheMisses);
+        algorithmReport.add("perfMallocBranchMisses", "Malloc branch misses", state.mallocCounters.branchMisses);
+        algorithmReport.add("perfFreeCycles", "Free cycles", state.freeCounters.cycles);
+        algorithmReport.add("perfFreeInstructions", "Free instructions", state.freeCounters.instructions);
+        algorithmReport.add("perfFreeCacheMisses", "Free cache misses", state.freeCounters.cacheMisses);
+        algorithmReport.add("perfFreeBranchMisses", "Free branch misses", state.freeCounters.branchMisses);
+    }
+}
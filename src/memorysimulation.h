@@ -3,9 +3,18 @@
 
 #include <string>
 #include <vector>
+#include <memory>
 #include "randomgenerator.h"
 #include "memoryallocator.h"
 #include "csvwriter.h"
+#include "simulationreport.h"
+#include "profiler.h"
+#include "perfcounters.h"
+#include "eventcalendar.h"
+#include "jobprocess.h"
+#include "steadystatedetector.h"
+#include "timeserieswriter.h"
+#include "occupancyheatmap.h"
 
 using namespace std;
 
@@ -18,17 +27,70 @@ struct SimulationConfig //inputs for running
     int percentLarge;
 
     int memoryUnitSize;
-    int memoryUnitCount;
+    long long memoryUnitCount; //64 bit so memories past 2 GiB work
 
     unsigned seed;
 
+    int arrivalHorizon; //jobs arrive before this tick
+    int prefillTime; //summary sampling starts here
+    int sampleInterval; //ticks between samples
+    int maxHeapElements; //generation stops adding heap elements past this many
+
+    bool steadyState; //detect the end of warm up instead of prefillTime, stop once confident
+    int steadyWindow; //samples per tolerance window and per batch
+    double steadyTolerance; //drift between the window halves, percent of their mean
+    double steadyHalfWidth; //stop when the 95% interval is within this percent of the mean
+
     string summaryFilePath;
     string logFileFirstFit;  //paths
     string logFileNextFit;
     string logFileBestFit;
     string logFileWorstFit;
+    string logFileLifetimeAware;
+
+    bool asyncLogWriter; //write logs on a background io thread
+
+    int logLevel; // 0=none 1=failures only 2=sampled 3=full
+    int logSampleEvery; // sampled level keeps 1 in N events
+
+    string timeSeriesFilePath; //metrics after every event that changed them, delta/varint binary, empty = off
+    string freeBlockFilePath; //log2 free block size histogram per sample, empty = off
+    int usableRequestBytes; //histogram rows: share of free memory a request this big could use
+    string heatmapFilePrefix; //occupancy image per algorithm, <prefix>_FF.pgm, empty = off
+    int heatmapRows; //address buckets
+    int heatmapInterval; //ticks between columns
+    int heatmapMaxColumns; //wider runs average neighbouring columns
+    string reportFilePath; //final statistics as json, empty = skip
+    bool textReport; //print human readable report to stdout
+
+    bool profile; //per phase wall clock + per algorithm throughput
+    bool perfCounters; //hardware counters per algorithm, implies profile
+
+    int engineType; // 0=scan (reference) 1=indexed free block engine
+    bool verifyEngines; //run the other engine alongside and compare every step
+
+    int ownershipType; // 0=unitJobId in memory 1=run map (forces indexed) 2=unitJobId mapped from a file
+    string unitMapFilePrefix; //ownershipType=2, one file per algorithm: <prefix>_FF.bin
+
+    string checkpointSavePath; //snapshot the whole state after checkpointTime, empty = off
+    int checkpointTime; // -1 = end of prefill
+    string checkpointLoadPath; //continue from a snapshot instead of building the workload
+
+    bool batchHeapAllocs; //place each ticks heap allocs with one mallocBatch per algorithm
+
+    bool jobArenas; //departure releases all of a jobs blocks in one request
+    int orphanHeapPolicy; // heap still alive at departure: 0=free with the job 1=keep until its own free
+
+    bool lifetimeAware; //add a 5th lane, LA, placing by the lifetime hint
+    int lifetimeThreshold; //LA: hints up to this many ticks count as short lived
+
+    bool admissionQueue; //arrivals and heap allocs that dont fit wait and retry after frees
+
+    int jobModel; // 0=all events built up front 1=a coroutine per job, events made as it runs
 
     SimulationConfig();
+
+    void redirectOutputs(const string &subdirectory); //every output path into <its dir>/<subdirectory>/, made here
 };
 
 
@@ -82,83 +144,183 @@ public:
         int getDepartureTime() const; //when element free
     };
 
-    struct Event
+
+    // generated jobs and heap elements. runs with the same seed, job mix,
+    // horizon and heap element cap generate the same ones, so one copy can
+    // be shared read only between them (prebuilt job model)
+    struct Workload
+    {
+        vector<Job> jobs;
+        vector<HeapElement> heapElements;
+        RandomGenerator rng; //state generation left, checkpoints save it
+        int jobSourceBaseTime;
+        int jobSourceNextArrival;
+    };
+
+    static shared_ptr<const Workload> generateWorkload(const SimulationConfig &cfg); //no allocators needed
+    shared_ptr<const Workload> sharedWorkload; //set before run() to skip generation
+    void adoptWorkload(const Workload &workload);
+
+    typedef ScheduledEvent Event; // 0=job arrive  1=job depart  2=heap alloc   3=heap free
+
+    struct WaitingRequest // --admissionQueue, a request that did not fit yet
     {
-        int time;
         int jobId;
-        int elementId;
-        int eventType; // 0=job arrive  1=job depart  2=heap alloc   3=heap free
+        int elementId; // -1 = job arrival, code and stack together
+        int queuedTime;
 
-        Event()
+        WaitingRequest()
         {
-            time = 0;
             jobId = -1;
             elementId = -1;
-            eventType = 0;
+            queuedTime = 0;
         }
     };
 
+    struct AlgorithmState //one placement policy and everything tracked for it
+    {
+        string shortName; //FF, NF, BF, WF
+        MemoryAllocator allocator;
+        MemoryAllocator verifyAllocator; // --verify, same requests on the other engine
+        string logFilePath;
+        CsvWriter *log;
+
+        // remember locations so we can free
+        vector<long long> jobCodeLocation;
+        vector<long long> jobStackLocation;
+        vector<long long> heapLocation;
+
+        long long heapAllocCount; //successfully alloc'd heap elements
+        long long heapAllocBytes;
+
+        long long sumPercentInUse;
+        long long sumPercentInternal;
+        int maxPercentInUse;
+        long long maxExternalFrag;
+
+        // --jobArenas, heap elements still alive when their job departs
+        long long orphanHeapElements;
+        long long orphanHeapBytes;
+        long long liveOrphanBytes; //keep policy, orphans not freed yet
+        long long peakLiveOrphanBytes;
+
+        // --admissionQueue, each algorithm has its own queue and so its own timeline
+        vector<WaitingRequest> waitQueue; //oldest first
+        vector<int> jobDelay; //ticks each job runs behind its schedule, from waiting for admission
+        vector<char> jobBlocked; //arrival still waiting
+        vector<vector<Event>> heldEvents; //per job, events that came while it was blocked
+        vector<int> heapDelay; //ticks a heap element waited, its free moves by the same
+        vector<char> heapWaiting; //1 queued, 2 queued and its free event already came
+        EventCalendar deferredEvents; //events of delayed jobs, keyed by when they are due
+        bool freedSinceRetry;
+
+        long long queuedRequests;
+        long long admittedRequests;
+        long long abandonedRequests; //heap requests still waiting when their job departed
+        OperationHistogram waitHistogram; //ticks waited per admitted request
+        long long totalWaitTicks;
+        long long queueLengthSum; //summed every tick, for the average
+        long long queueTicks;
+        long long peakQueueLength;
+        long long finishedJobs;
+        long long delayedJobs;
+        long long sumSlowdownPercent; //100*(runTime+delay)/runTime per finished job
+        long long maxSlowdownPercent;
+
+        // --profile, time spent inside this algorithm
+        long long mallocCalls;
+        long long mallocNanoseconds;
+        long long freeCalls;
+        long long freeNanoseconds;
+        long long eventNanoseconds;
+
+        PerfCounterValues mallocCounters; // --perfCounters
+        PerfCounterValues freeCounters;
+
+        OccupancyHeatmap heatmap; // --heatmap
+
+        AlgorithmState()
+        {
+            log = nullptr;
+            heapAllocCount = 0;
+            heapAllocBytes = 0;
+            sumPercentInUse = 0;
+            sumPercentInternal = 0;
+            maxPercentInUse = 0;
+            maxExternalFrag = 0;
+            orphanHeapElements = 0;
+            orphanHeapBytes = 0;
+            liveOrphanBytes = 0;
+            peakLiveOrphanBytes = 0;
+            freedSinceRetry = false;
+            queuedRequests = 0;
+            admittedRequests = 0;
+            abandonedRequests = 0;
+            totalWaitTicks = 0;
+            queueLengthSum = 0;
+            queueTicks = 0;
+            peakQueueLength = 0;
+            finishedJobs = 0;
+            delayedJobs = 0;
+            sumSlowdownPercent = 0;
+            maxSlowdownPercent = 0;
+            mallocCalls = 0;
+            mallocNanoseconds = 0;
+            freeCalls = 0;
+            freeNanoseconds = 0;
+            eventNanoseconds = 0;
+        }
+
+        void resetCounters();
+    };
+
     SimulationConfig config;
     RandomGenerator rng;
 
+    vector<AlgorithmState> algorithms; //FF, NF, BF, WF in that order, then LA if lifetimeAware
+
+    vector<Job> jobs;
+    vector<HeapElement> heapElements;
+    EventCalendar calendar; //pending events by tick, then event type
+    vector<vector<int>> jobHeapElements; //jobId -> its heap element ids
 
-    int heapAllocCountFF; //successfully alloc'd heap elements per type
-    int heapAllocCountNF;
-    int heapAllocCountBF;
-    int heapAllocCountWF;
+    // job source, jobs are drawn in id order whether up front or tick by tick
+    bool jobSourceActive;
+    int jobSourceBaseTime; //base time of the next job, it arrives 0-4 ticks later
+    int jobSourceNextArrival;
 
-    int heapAllocBytesFF;
-    int heapAllocBytesNF;
-    int heapAllocBytesBF;
-    int heapAllocBytesWF;
+    vector<JobProcess> liveJobs; // --jobModel coroutine, id order
 
+    TimeSeriesWriter timeSeries; // --timeSeries
+    void recordTimeSeries(int time); //every algorithm, O(1) counters only
 
-    MemoryAllocator allocatorFirstFit;  //mem alloc per alg
-    MemoryAllocator allocatorNextFit;
-    MemoryAllocator allocatorBestFit;
-    MemoryAllocator allocatorWorstFit;
+    SteadyStateDetector steadyDetector; // --steadyState
+    void sampleSteadyState(int time); //every algorithm, every sampleInterval ticks from 0
 
-    vector<Job> jobs;
-    vector<HeapElement> heapElements;
-    vector<Event> events;
-
-    // remember locations so we can free
-    vector<int> jobCodeLocationFF;
-    vector<int> jobStackLocationFF;
-    vector<int> jobCodeLocationNF;
-    vector<int> jobStackLocationNF;
-    vector<int> jobCodeLocationBF;
-    vector<int> jobStackLocationBF;
-    vector<int> jobCodeLocationWF;
-    vector<int> jobStackLocationWF;
-
-    vector<int> heapLocationFF;
-    vector<int> heapLocationNF;
-    vector<int> heapLocationBF;
-    vector<int> heapLocationWF;
-
-//-/-/
     int sampleCount;
-    int sumPercentInUseFF;
-    int sumPercentInUseNF;
-    int sumPercentInUseBF;
-    int sumPercentInUseWF;
-    int sumPercentInternalFF;
-    int sumPercentInternalNF;
-    int sumPercentInternalBF;
-    int sumPercentInternalWF;
-    int maxPercentInUseFF;
-    int maxPercentInUseNF;
-    int maxPercentInUseBF;
-    int maxPercentInUseWF;
-    int maxExternalFragFF;
-    int maxExternalFragNF;
-    int maxExternalFragBF;
-    int maxExternalFragWF;
-//-////-/
+    long long processedEventCount;
+
+    Profiler profiler;
+    PerfCounters perfCounters;
+
+    // --verify
+    const Event *currentEvent; //for divergence context
+    int currentEventTime;
+    long long verifyCheckCount;
+    bool verifyFailed;
+    string verifyMessage; //first divergence
+
+    // warnings, errors and the verify result. a run on a worker thread sets
+    // printMessages false before configure and the caller prints messages
+    // afterwards, so threads never write to cout at the same time
+    bool printMessages;
+    string messages;
+    void message(const string &text);
 
     void initializeAllocators();
 
+    static int percentOf(long long part, long long whole); //100*part/whole without overflow
+
     int chooseJobType(); // return 0/1/2 for S/M/L
 
     Job createRandomJob(int jobIdValue, int arrivalTime); //
@@ -166,12 +328,59 @@ public:
     void createHeapElementsForJob(const Job &job);
 
     void buildJobsAndHeapElements(); //gen all jobs and heap elements
+    void startJobSource(); //clear the workload, draw the first arrival
+    void generateJobsUntil(int baseTimeLimit);
+    void indexJobHeapElements(); //rebuild jobHeapElements from heapElements
+
+    JobProcess runJobProcess(Job job, int startTime); //coroutine body, reads heapElements by id
+    JobProcess startJobProcess(const Job &job, int startTime);
+    void advanceJobProcesses(int currentTime); //make due jobs, collect this ticks events
     void buildEvents();  // conv into events
 
-    void processEventsAtTime(int currentTime, CsvWriter &logFF, CsvWriter &logNF, CsvWriter &logBF, CsvWriter &logWF);
+    void processEventsAtTime(int currentTime);
+    void processEventForAlgorithm(AlgorithmState &state, const Event &ev, int currentTime);
+    void processHeapAllocBatch(const vector<Event> &batch, int currentTime); //heap allocs of one tick
+    void releaseJobArena(AlgorithmState &state, const Job &job, int currentTime); //departure with --jobArenas
+
+    // --admissionQueue
+    void dispatchEvent(AlgorithmState &state, const Event &ev, int currentTime); //run now, defer by the jobs delay or hold
+    void runDeferredEvents(AlgorithmState &state, int currentTime);
+    bool placeJob(AlgorithmState &state, const Job &job, int currentTime); //code and stack, or neither
+    bool placeHeapElement(AlgorithmState &state, const HeapElement &element, int currentTime);
+    void queueRequest(AlgorithmState &state, int jobId, int elementId, int sizeBytes, int currentTime);
+    void retryWaitingRequests(AlgorithmState &state, int currentTime);
+    void finishJob(AlgorithmState &state, const Job &job); //slowdown, drops heap requests still waiting
+
+    long long timedMalloc(AlgorithmState &state, int sizeBytes, int lifetimeHint); //malloc with --profile timing
+    void timedMallocBatch(AlgorithmState &state, const vector<long long> &sizes, const vector<int> &jobIds, const vector<int> &lifetimeHints, vector<long long> &locations);
+    void timedFree(AlgorithmState &state, long long location);
+    void timedFreeJobArena(AlgorithmState &state, int jobId, const vector<long long> &keepStarts, vector<long long> &releasedStarts);
+
+    void sampleAlgorithm(AlgorithmState &state, int time, CsvWriter &summaryWriter); //one summary.csv row
+    void sampleFreeBlocks(AlgorithmState &state, int time, CsvWriter &writer); //one --freeBlockHistogram row
+
+    void setJobForAlgorithm(AlgorithmState &state, int jobId);
+    bool verifyValue(AlgorithmState &state, const string &what, long long expected, long long actual);
+    void verifySample(AlgorithmState &state, int time);
+
+    long long logEventSequence; //events seen so far, for sampled logging
+    bool logSampledEvent; //current event picked by the sampler
+
+    bool shouldLog(bool failed); //check log level before building a row
+
+    // checkpoint: workload, rng, allocators, locations and running metrics
+    bool saveCheckpoint(const string &path, int time);
+    bool loadCheckpoint(const string &path, int &resumeTime); //resumeTime = first tick still to run
+    bool checkpointFailed;
+
+    SimulationReport report; //final statistics of the last run()
+
+    AlgorithmReport buildAlgorithmReport(AlgorithmState &state, int totalTimeSteps);
+    void addProfileReport(SimulationReport &report, long long tickLoopNanoseconds, bool perfCountersUsed);
 
-    void logAllocation(CsvWriter &writer, int time, int jobId, int sizeBytes, int location); //alloc log row
-    void logFree(CsvWriter &writer, int time, int jobId, int location); //free log row
+    void logAllocation(CsvWriter &writer, int time, int jobId, int sizeBytes, long long location); //alloc log row
+    void logFree(CsvWriter &writer, int time, int jobId, long long location); //free log row
+    void logQueued(CsvWriter &writer, int time, int jobId, int sizeBytes); // --admissionQueue, request had to wait
 };
 
 #endif // MEMORYSIMULATION_H
@@ -0,0 +1,141 @@
+#include "occupancyheatmap.h"
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+
+
+OccupancyHeatmap::OccupancyHeatmap()
+{
+    memoryUnitCount = 0;
+    rows = 0;
+    maxColumns = 0;
+    columnCount = 0;
+    samplesPerColumn = 1;
+    pendingSamples = 0;
+}
+
+
+void OccupancyHeatmap::configure(long long memoryUnitCountValue, int rowsValue, int maxColumnsValue)
+{
+    memoryUnitCount = memoryUnitCountValue;
+
+    rows = (rowsValue > 0) ? rowsValue : 1;
+    if (memoryUnitCount > 0 && rows > memoryUnitCount) rows = (int)memoryUnitCount; //no empty rows
+    maxColumns = (maxColumnsValue > 1) ? maxColumnsValue : 2; //halving needs two
+
+    pixels.clear();
+    columnCount = 0;
+    samplesPerColumn = 1;
+    pendingAllocated.assign(rows, 0);
+    pendingSamples = 0;
+}
+
+
+long long OccupancyHeatmap::rowStart(int row)
+{
+    return memoryUnitCount * row / rows;
+}
+
+
+// every row starts fully allocated and each free block takes its units
+// off the rows it overlaps, so the work is blocks + rows
+void OccupancyHeatmap::addSample(FreeBlockIndex &freeBlocks)
+{
+    if (memoryUnitCount <= 0) return;
+
+    for (int r = 0; r < rows; r++) pendingAllocated[r] += rowStart(r + 1) - rowStart(r);
+
+    int row = 0;
+    for (map<long long, long long>::iterator it = freeBlocks.blocksByStart.begin(); it != freeBlocks.blocksByStart.end(); ++it)
+    {
+        long long start = it->first;
+        long long end = it->first + it->second;
+
+        while (row < rows - 1 && rowStart(row + 1) <= start) row++; //blocks come in address order
+
+        for (int r = row; r < rows && rowStart(r) < end; r++)
+        {
+            long long overlapStart = max(start, rowStart(r));
+            long long overlapEnd = min(end, rowStart(r + 1));
+            if (overlapEnd > overlapStart) pendingAllocated[r] -= overlapEnd - overlapStart;
+        }
+    }
+
+    pendingSamples++;
+    if (pendingSamples == samplesPerColumn) finishColumn();
+}
+
+
+void OccupancyHeatmap::finishColumn()
+{
+    if (pendingSamples == 0) return;
+
+    for (int r = 0; r < rows; r++)
+    {
+        long long rowUnits = (rowStart(r + 1) - rowStart(r)) * pendingSamples;
+        long long value = (rowUnits > 0) ? (pendingAllocated[r] * 255 + rowUnits / 2) / rowUnits : 0;
+        pixels.push_back((unsigned char)value);
+        pendingAllocated[r] = 0;
+    }
+
+    columnCount++;
+    pendingSamples = 0;
+
+    if (columnCount == maxColumns) halveColumns();
+}
+
+
+// pairs of columns become one, from here on a column takes twice the samples
+void OccupancyHeatmap::halveColumns()
+{
+    int kept = 0;
+    for (int c = 0; c + 1 < columnCount; c += 2)
+    {
+        for (int r = 0; r < rows; r++)
+        {
+            int sum = pixels[(size_t)c * rows + r] + pixels[(size_t)(c + 1) * rows + r];
+            pixels[(size_t)kept * rows + r] = (unsigned char)((sum + 1) / 2);
+        }
+        kept++;
+    }
+
+    if (columnCount % 2 == 1) //odd one out stays as it is
+    {
+        for (int r = 0; r < rows; r++) pixels[(size_t)kept * rows + r] = pixels[(size_t)(columnCount - 1) * rows + r];
+        kept++;
+    }
+
+    columnCount = kept;
+    pixels.resize((size_t)columnCount * rows);
+    samplesPerColumn *= 2;
+}
+
+
+bool OccupancyHeatmap::writePgm(const string &path)
+{
+    finishColumn(); //last partial column
+
+    if (path.empty() || columnCount == 0) return false;
+
+    filesystem::path parent = filesystem::path(path).parent_path();
+    if (!parent.empty())
+    {
+        error_code ec;
+        filesystem::create_directories(parent, ec); //errors go into ec
+    }
+
+    // pgm wants rows top to bottom, pixels are kept a column at a time
+    string text = "P5\n" + to_string(columnCount) + " " + to_string(rows) + "\n255\n";
+    size_t headerSize = text.size();
+    text.resize(headerSize + (size_t)columnCount * rows);
+    for (int r = 0; r < rows; r++)
+    {
+        for (int c = 0; c < columnCount; c++) text[headerSize + (size_t)r * columnCount + c] = (char)pixels[(size_t)c * rows + r];
+    }
+
+    ofstream out(path, ios::binary);
+    if (!out) return false;
+
+    out.write(text.data(), (streamsize)text.size());
+    return (bool)out;
+}
@@ -0,0 +1,42 @@
+#ifndef OCCUPANCYHEATMAP_H
+#define OCCUPANCYHEATMAP_H
+
+#include <string>
+#include <vector>
+#include "freeblockindex.h"
+
+using namespace std;
+
+// --heatmap, memory layout over time as a greyscale image: one column per
+// sample (time left to right), one row per address bucket (address 0 at the
+// top), white = bucket fully allocated. a column is one pass over the free
+// blocks, not the units, and the image never grows past maxColumns: when it
+// would, neighbouring columns are averaged and later columns cover twice the
+// samples, so memory stays rows * maxColumns bytes however long the run
+class OccupancyHeatmap
+{
+public:
+    OccupancyHeatmap();
+
+    void configure(long long memoryUnitCount, int rows, int maxColumns);
+    void addSample(FreeBlockIndex &freeBlocks);
+    bool writePgm(const string &path); //binary P5, creates parent dir
+
+    long long memoryUnitCount;
+    int rows;
+    int maxColumns;
+
+    vector<unsigned char> pixels; //column major, column * rows + row
+    int columnCount;
+    long long samplesPerColumn;
+
+    vector<long long> pendingAllocated; //allocated units per row, summed over the current column's samples
+    long long pendingSamples;
+
+    long long rowStart(int row); //first unit of a row
+
+    void finishColumn();
+    void halveColumns();
+};
+
+#endif // OCCUPANCYHEATMAP_H
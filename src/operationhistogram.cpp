@@ -0,0 +1,106 @@
+#include "operationhistogram.h"
+
+static const int subBucketBits = 4;
+static const int subBucketCount = 1 << subBucketBits; //16
+static const int bucketTotal = subBucketCount + (63 - subBucketBits) * subBucketCount;
+
+
+OperationHistogram::OperationHistogram()
+{
+    buckets.assign(bucketTotal, 0);
+    count = 0;
+    maxValue = 0;
+}
+
+
+void OperationHistogram::reset()
+{
+    buckets.assign(bucketTotal, 0);
+    count = 0;
+    maxValue = 0;
+}
+
+
+// values below 16 get their own bucket, above that 16 buckets per power of two
+int OperationHistogram::bucketIndex(long long value)
+{
+    if (value < subBucketCount)
+    {
+        if (value < 0) return 0;
+        return (int)value;
+    }
+
+    int exponent = 63 - __builtin_clzll((unsigned long long)value); //floor(log2)
+    int shift = exponent - subBucketBits;
+    int sub = (int)((value >> shift) & (subBucketCount - 1));
+
+    return subBucketCount + shift * subBucketCount + sub;
+}
+
+
+long long OperationHistogram::bucketHighestValue(int index)
+{
+    if (index < subBucketCount) return index;
+
+    int shift = (index - subBucketCount) / subBucketCount;
+    int sub = (index - subBucketCount) % subBucketCount;
+
+    long long low = ((long long)(subBucketCount + sub)) << shift;
+    return low + ((1LL << shift) - 1);
+}
+
+
+void OperationHistogram::record(long long value)
+{
+    buckets[bucketIndex(value)]++;
+    count++;
+    if (value > maxValue) maxValue = value;
+}
+
+
+long long OperationHistogram::percentile(double percent)
+{
+    if (count == 0) return 0;
+
+    // rank of the value we want, 1 based
+    long long target = (long long)((percent / 100.0) * (double)count + 0.5);
+    if (target < 1) target = 1;
+    if (target > count) target = count;
+
+    long long seen = 0;
+    for (int i = 0; i < (int)buckets.size(); i++)
+    {
+        seen += buckets[i];
+        if (seen >= target)
+        {
+            long long value = bucketHighestValue(i);
+            if (value > maxValue) value = maxValue; //top bucket can overshoot
+            return value;
+        }
+    }
+
+    return maxValue;
+}
+
+
+long long OperationHistogram::getCount() {return count;}
+long long OperationHistogram::getMax() {return maxValue;}
+
+
+void OperationHistogram::saveState(BinaryWriter &out)
+{
+    out.writeIntVector(buckets);
+    out.writeInt(count);
+    out.writeInt(maxValue);
+}
+
+bool OperationHistogram::loadState(BinaryReader &in)
+{
+    vector<long long> values = in.readIntVector();
+    if (!in.ok || values.size() != buckets.size()) return false;
+
+    buckets = values;
+    count = in.readInt();
+    maxValue = in.readInt();
+    return in.ok;
+}
@@ -0,0 +1,35 @@
+#ifndef OPERATIONHISTOGRAM_H
+#define OPERATIONHISTOGRAM_H
+
+#include <vector>
+#include "binaryio.h"
+
+using namespace std;
+
+// log bucketed (hdr style) histogram of non negative counts
+// 16 sub buckets per power of two, so a percentile is within ~6% of the
+// real value, and memory stays the same however many values get recorded
+class OperationHistogram
+{
+public:
+    OperationHistogram();
+
+    void reset();
+    void record(long long value);
+
+    long long percentile(double percent); //percent 0-100, highest value of the bucket it falls in
+    long long getCount();
+    long long getMax();
+
+    void saveState(BinaryWriter &out); //checkpoint
+    bool loadState(BinaryReader &in);
+
+    static int bucketIndex(long long value);
+    static long long bucketHighestValue(int index);
+
+    vector<long long> buckets;
+    long long count;
+    long long maxValue;
+};
+
+#endif // OPERATIONHISTOGRAM_H
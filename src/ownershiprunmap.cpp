@@ -0,0 +1,115 @@
+#include "ownershiprunmap.h"
+
+
+OwnershipRunMap::OwnershipRunMap()
+{
+    memoryUnitCount = 0;
+    ownedUnits = 0;
+}
+
+
+void OwnershipRunMap::reset(long long memoryUnitCountValue)
+{
+    memoryUnitCount = memoryUnitCountValue;
+    ownedUnits = 0;
+    runs.clear();
+}
+
+
+void OwnershipRunMap::cutAt(long long unitIndex)
+{
+    map<long long, OwnedRun>::iterator it = runs.upper_bound(unitIndex);
+    if (it == runs.begin()) return;
+    --it;
+
+    long long runEnd = it->first + it->second.length;
+    if (it->first == unitIndex || runEnd <= unitIndex) return; //already a boundary or a gap
+
+    OwnedRun tail;
+    tail.length = runEnd - unitIndex;
+    tail.jobId = it->second.jobId;
+
+    it->second.length = unitIndex - it->first;
+    runs[unitIndex] = tail;
+}
+
+
+void OwnershipRunMap::release(long long startIndex, long long unitCount)
+{
+    long long end = startIndex + unitCount;
+    if (end > memoryUnitCount) end = memoryUnitCount;
+    if (startIndex < 0) startIndex = 0;
+    if (end <= startIndex) return;
+
+    cutAt(startIndex);
+    cutAt(end);
+
+    map<long long, OwnedRun>::iterator it = runs.lower_bound(startIndex);
+    while (it != runs.end() && it->first < end)
+    {
+        ownedUnits -= it->second.length;
+        it = runs.erase(it);
+    }
+}
+
+
+void OwnershipRunMap::assign(long long startIndex, long long unitCount, int jobId)
+{
+    if (jobId == -1)
+    {
+        release(startIndex, unitCount);
+        return;
+    }
+
+    long long end = startIndex + unitCount;
+    if (end > memoryUnitCount) end = memoryUnitCount;
+    if (startIndex < 0) startIndex = 0;
+    if (end <= startIndex) return;
+
+    release(startIndex, end - startIndex);
+
+    long long start = startIndex;
+    long long length = end - startIndex;
+
+    // merge with same job neighbours so back to back allocs stay one run
+    map<long long, OwnedRun>::iterator next = runs.find(end);
+    if (next != runs.end() && next->second.jobId == jobId)
+    {
+        length += next->second.length;
+        runs.erase(next);
+    }
+
+    map<long long, OwnedRun>::iterator prev = runs.lower_bound(start);
+    if (prev != runs.begin())
+    {
+        --prev;
+        if (prev->first + prev->second.length == start && prev->second.jobId == jobId)
+        {
+            start = prev->first;
+            length += prev->second.length;
+            runs.erase(prev);
+        }
+    }
+
+    OwnedRun run;
+    run.length = length;
+    run.jobId = jobId;
+    runs[start] = run;
+
+    ownedUnits += end - startIndex;
+}
+
+
+int OwnershipRunMap::getJobId(long long unitIndex)
+{
+    map<long long, OwnedRun>::iterator it = runs.upper_bound(unitIndex);
+    if (it == runs.begin()) return -1;
+    --it;
+
+    if (unitIndex < it->first + it->second.length) return it->second.jobId;
+    return -1;
+}
+
+
+long long OwnershipRunMap::getRunCount() {return (long long)runs.size();}
+long long OwnershipRunMap::getOwnedUnits() {return ownedUnits;}
@@ -0,0 +1,44 @@
+#ifndef OWNERSHIPRUNMAP_H
+#define OWNERSHIPRUNMAP_H
+
+#include <map>
+
+using namespace std;
+
+struct OwnedRun
+{
+    long long length;
+    int jobId;
+
+    OwnedRun()
+    {
+        length = 0;
+        jobId = -1;
+    }
+};
+
+
+// unit ownership stored as runs instead of one int per unit
+// only owned runs are kept, gaps are free (-1), so size follows live allocations
+class OwnershipRunMap
+{
+public:
+    OwnershipRunMap();
+
+    void reset(long long memoryUnitCountValue); //everything free
+    void assign(long long startIndex, long long unitCount, int jobId); //overwrites whatever was there
+    void release(long long startIndex, long long unitCount);
+
+    int getJobId(long long unitIndex); //-1 = free
+    long long getRunCount();
+    long long getOwnedUnits();
+
+    long long memoryUnitCount;
+    long long ownedUnits;
+
+    map<long long, OwnedRun> runs; //start -> run, address order
+
+    void cutAt(long long unitIndex); //split the run covering unitIndex so a run starts there
+};
+
+#endif // OWNERSHIPRUNMAP_H
@@ -0,0 +1,121 @@
+#include "perfcounters.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <string.h>
+#endif
+
+
+void PerfCounterValues::add(const PerfCounterValues &start, const PerfCounterValues &end)
+{
+    cycles += end.cycles - start.cycles;
+    instructions += end.instructions - start.instructions;
+    cacheMisses += end.cacheMisses - start.cacheMisses;
+    branchMisses += end.branchMisses - start.branchMisses;
+}
+
+
+PerfCounters::PerfCounters()
+{
+    available = false;
+    leaderFd = -1;
+    for (int i = 0; i < 3; i++) memberFds[i] = -1;
+}
+
+PerfCounters::~PerfCounters()
+{
+    close();
+}
+
+
+#ifdef __linux__
+
+static int openCounter(unsigned long long counterConfig, int groupFd)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = counterConfig;
+    attr.disabled = (groupFd == -1) ? 1 : 0; //leader starts disabled, enables whole group
+    attr.exclude_kernel = 1; //user space only, works with perf_event_paranoid 2
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP;
+
+    // this thread, any cpu
+    return (int)syscall(__NR_perf_event_open, &attr, 0, -1, groupFd, 0);
+}
+
+
+bool PerfCounters::open()
+{
+    close();
+
+    leaderFd = openCounter(PERF_COUNT_HW_CPU_CYCLES, -1);
+    if (leaderFd < 0) return false;
+
+    unsigned long long memberConfigs[3] = {PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+
+    for (int i = 0; i < 3; i++)
+    {
+        memberFds[i] = openCounter(memberConfigs[i], leaderFd);
+        if (memberFds[i] < 0)
+        {
+            close(); //all or nothing, mixed sets are hard to compare
+            return false;
+        }
+    }
+
+    ioctl(leaderFd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    if (ioctl(leaderFd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP) != 0)
+    {
+        close();
+        return false;
+    }
+
+    available = true;
+    return true;
+}
+
+
+void PerfCounters::close()
+{
+    for (int i = 0; i < 3; i++)
+    {
+        if (memberFds[i] >= 0) ::close(memberFds[i]);
+        memberFds[i] = -1;
+    }
+
+    if (leaderFd >= 0) ::close(leaderFd);
+    leaderFd = -1;
+    available = false;
+}
+
+
+PerfCounterValues PerfCounters::read()
+{
+    PerfCounterValues values;
+    if (!available) return values;
+
+    // group format: count, then one value per counter in open order
+    unsigned long long buffer[5];
+    ssize_t bytes = ::read(leaderFd, buffer, sizeof(buffer));
+    if (bytes < (ssize_t)sizeof(buffer) || buffer[0] != 4) return values;
+
+    values.cycles = (long long)buffer[1];
+    values.instructions = (long long)buffer[2];
+    values.cacheMisses = (long long)buffer[3];
+    values.branchMisses = (long long)buffer[4];
+    return values;
+}
+
+#else
+
+bool PerfCounters::open() {return false;} //no perf_event_open here
+void PerfCounters::close() {available = false;}
+PerfCounterValues PerfCounters::read() {return PerfCounterValues();}
+
+#endif
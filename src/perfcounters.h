@@ -0,0 +1,44 @@
+#ifndef PERFCOUNTERS_H
+#define PERFCOUNTERS_H
+
+using namespace std;
+
+struct PerfCounterValues //hardware counts, user space only
+{
+    long long cycles;
+    long long instructions;
+    long long cacheMisses;
+    long long branchMisses;
+
+    PerfCounterValues()
+    {
+        cycles = 0;
+        instructions = 0;
+        cacheMisses = 0;
+        branchMisses = 0;
+    }
+
+    void add(const PerfCounterValues &start, const PerfCounterValues &end); //add end - start
+};
+
+
+// cycles, instructions, cache misses and branch misses for this thread
+// through perf_event_open (linux only, no library needed)
+// if the kernel wont give us counters available stays false and
+// read() just returns zeros, callers fall back to wall clock
+class PerfCounters
+{
+public:
+    PerfCounters();
+    ~PerfCounters();
+
+    bool open(); //true if counters are running
+    void close();
+    PerfCounterValues read(); //running totals since open
+
+    bool available;
+    int leaderFd; //group leader, one read gets all four
+    int memberFds[3];
+};
+
+#endif // PERFCOUNTERS_H
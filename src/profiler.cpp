@@ -0,0 +1,70 @@
+#include "profiler.h"
+#include <chrono>
+
+
+Profiler::Profiler()
+{
+    enabled = false;
+}
+
+
+void Profiler::reset()
+{
+    phases.clear();
+}
+
+
+int Profiler::phaseIndex(const string &name)
+{
+    for (int i = 0; i < (int)phases.size(); i++)
+    {
+        if (phases[i].name == name) return i;
+    }
+
+    PhaseTiming phase;
+    phase.name = name;
+    phases.push_back(phase);
+    return (int)phases.size() - 1;
+}
+
+
+void Profiler::add(int phase, long long nanosecondsValue)
+{
+    if (phase < 0 || phase >= (int)phases.size()) return;
+
+    phases[phase].nanoseconds += nanosecondsValue;
+    phases[phase].calls++;
+}
+
+
+long long Profiler::nowNanoseconds()
+{
+    return (long long)chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+
+ScopedTimer::ScopedTimer(Profiler &profilerValue, int phaseValue) : profiler(profilerValue)
+{
+    phase = phaseValue;
+    total = nullptr;
+    startTime = 0;
+    if (profiler.enabled) startTime = Profiler::nowNanoseconds();
+}
+
+ScopedTimer::ScopedTimer(Profiler &profilerValue, int phaseValue, long long &totalValue) : profiler(profilerValue)
+{
+    phase = phaseValue;
+    total = &totalValue;
+    startTime = 0;
+    if (profiler.enabled) startTime = Profiler::nowNanoseconds();
+}
+
+ScopedTimer::~ScopedTimer()
+{
+    if (!profiler.enabled) return;
+
+    long long elapsed = Profiler::nowNanoseconds() - startTime;
+    if (phase >= 0) profiler.add(phase, elapsed);
+    if (total) *total += elapsed;
+}
@@ -0,0 +1,53 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+struct PhaseTiming //wall clock for one named phase of a run
+{
+    string name;
+    long long nanoseconds;
+    long long calls;
+
+    PhaseTiming()
+    {
+        nanoseconds = 0;
+        calls = 0;
+    }
+};
+
+
+class Profiler
+{
+public:
+    Profiler();
+
+    void reset();
+    int phaseIndex(const string &name); //find phase, add it if new
+    void add(int phase, long long nanosecondsValue);
+
+    static long long nowNanoseconds(); //steady clock
+
+    bool enabled; //off = timers do nothing
+    vector<PhaseTiming> phases;
+};
+
+
+// times the scope it lives in, adds to one phase when it goes out of scope
+class ScopedTimer
+{
+public:
+    ScopedTimer(Profiler &profilerValue, int phaseValue);
+    ScopedTimer(Profiler &profilerValue, int phaseValue, long long &totalValue); //also adds into a counter
+    ~ScopedTimer();
+
+    Profiler &profiler;
+    int phase;
+    long long *total;
+    long long startTime;
+};
+
+#endif // PROFILER_H
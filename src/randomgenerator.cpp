@@ -37,3 +37,21 @@ int RandomGenerator::randomInclusive(int low, int high)
 }
 
 
+
+
+void RandomGenerator::saveState(BinaryWriter &out)
+{
+    for (int i = 0; i < 31; i++) out.writeInt(rngGenerator.table[i]);
+    out.writeInt(rngGenerator.front);
+    out.writeInt(rngGenerator.rear);
+}
+
+bool RandomGenerator::loadState(BinaryReader &in)
+{
+    for (int i = 0; i < 31; i++) rngGenerator.table[i] = (uint32_t)in.readInt();
+    rngGenerator.front = (int)in.readInt();
+    rngGenerator.rear = (int)in.readInt();
+
+    if (rngGenerator.front < 0 || rngGenerator.front >= 31 || rngGenerator.rear < 0 || rngGenerator.rear >= 31) return false;
+    return in.ok;
+}
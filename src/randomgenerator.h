@@ -2,19 +2,49 @@
 #define RANDOMGENERATOR_H
 
 using namespace std;
-#include <cstdlib>
+#include <cstdint>
+#include "binaryio.h"
 
 
 
+// same additive feedback generator glibc rand() uses (TYPE_3, r[i] = r[i-3] + r[i-31]),
+// so seeds give the sequences they always did on linux, but the state lives
+// in the object: threads dont share it and a checkpoint can save it
 struct randEngine
 {
+    uint32_t table[31];
+    int front; //glibc fptr
+    int rear;  //glibc rptr
+
+    randEngine() {
+        seed(1);
+    }
+
     void seed(unsigned s) {
-        srand(s);
+        int32_t word = (int32_t)s;
+        if (word == 0) word = 1;
+
+        table[0] = (uint32_t)word;
+        for (int i = 1; i < 31; i++) //16807 lcg without overflow, same as srandom_r
+        {
+            int32_t hi = word / 127773;
+            int32_t lo = word % 127773;
+            word = 16807 * lo - 2836 * hi;
+            if (word < 0) word += 2147483647;
+            table[i] = (uint32_t)word;
+        }
+
+        front = 3;
+        rear = 0;
+        for (int i = 0; i < 310; i++) (*this)(); //glibc throws away the first 10*31
     }
 
     unsigned int operator()() { //give raw random number
-        int r = rand();
-        unsigned int u = (unsigned int) r; // conv to unsigned int by casting
+        table[front] += table[rear];
+        unsigned int u = table[front] >> 1; // 31 bits like rand()
+
+        front = (front + 1) % 31;
+        rear = (rear + 1) % 31;
         return u;
     }
 };
@@ -29,6 +59,9 @@ public:
     void reseed(unsigned seed);
     int randomInclusive(int low, int high);
 
+    void saveState(BinaryWriter &out); //checkpoint
+    bool loadState(BinaryReader &in);
+
 
     randEngine rngGenerator;
 };
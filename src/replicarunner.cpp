@@ -0,0 +1,340 @@
+#include "replicarunner.h"
+#include "steadystatedetector.h"
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <thread>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+
+
+ReplicaRunner::ReplicaRunner()
+{
+    replicaStep = 1;
+    threadCount = 1;
+    targetHalfWidthPercent = 0;
+    stopMetric = "avgPercentMemoryInUse";
+    maxReplicas = 100;
+    stoppedEarly = false;
+    failed = false;
+}
+
+
+void ReplicaRunner::configure(const SimulationConfig &baseConfigValue, int replicas, int threads)
+{
+    baseConfig = baseConfigValue;
+    replicaStep = (replicas > 0) ? replicas : 1;
+
+    threadCount = threads;
+    if (threadCount <= 0) threadCount = (int)thread::hardware_concurrency();
+    if (threadCount <= 0) threadCount = 1; //unknown core count
+}
+
+
+void ReplicaRunner::setStopping(double targetHalfWidthPercentValue, const string &metricKey, int maxReplicasValue)
+{
+    targetHalfWidthPercent = targetHalfWidthPercentValue;
+    stopMetric = metricKey;
+    maxReplicas = maxReplicasValue;
+}
+
+
+bool ReplicaRunner::run()
+{
+    reports.clear();
+    replicaFailed.clear();
+    replicaMessages.clear();
+    stoppedEarly = false;
+    failed = false;
+
+    // rounds of replicaStep seeds, so where it stops does not depend on the
+    // thread count
+    int done = 0;
+    int target = replicaStep;
+    if (targetHalfWidthPercent > 0 && target > maxReplicas) target = maxReplicas;
+
+    while (true)
+    {
+        runRange(done, target);
+        for (int i = done; i < target; i++) cout << replicaMessages[i]; //seed order, from this thread only
+        done = target;
+        summarise();
+
+        for (int i = 0; i < done; i++) if (replicaFailed[i]) failed = true;
+        if (failed || targetHalfWidthPercent <= 0) break;
+
+        int narrow = stopMetricNarrow();
+        if (narrow < 0)
+        {
+            cout << "Error: unknown replica metric " << stopMetric << endl;
+            return false;
+        }
+        if (narrow == 1)
+        {
+            stoppedEarly = true;
+            break;
+        }
+        if (done >= maxReplicas) break;
+
+        target = done + replicaStep;
+        if (target > maxReplicas) target = maxReplicas;
+    }
+
+    if (!baseConfig.reportFilePath.empty() && !writeJson(baseConfig.reportFilePath))
+    {
+        cout << "Warning: could not write report " << baseConfig.reportFilePath << "\n";
+    }
+
+    if (baseConfig.textReport) cout << toText();
+
+    return !failed;
+}
+
+
+void ReplicaRunner::runRange(int first, int last)
+{
+    reports.resize(last);
+    replicaFailed.resize(last, 0);
+    replicaMessages.resize(last);
+
+    atomic<int> next(first);
+    int workers = threadCount;
+    if (workers > last - first) workers = last - first;
+
+    // each worker takes the next seed until none are left, results go into
+    // their own slot so the summary is the same whatever ran where
+    vector<thread> pool;
+    for (int w = 0; w < workers; w++)
+    {
+        pool.push_back(thread([this, &next, last]()
+        {
+            while (true)
+            {
+                int index = next.fetch_add(1);
+                if (index >= last) break;
+                runReplica(index);
+            }
+        }));
+    }
+
+    for (size_t w = 0; w < pool.size(); w++) pool[w].join();
+}
+
+
+void ReplicaRunner::runReplica(int index)
+{
+    SimulationConfig config = baseConfig;
+    config.seed = baseConfig.seed + (unsigned)index;
+    config.textReport = false; //one table at the end instead
+
+    config.redirectOutputs("replica_" + to_string(index));
+
+    MemorySimulation simulation;
+    simulation.printMessages = false; //run() prints them once the round is done
+    simulation.configure(config);
+    simulation.run();
+
+    reports[index] = simulation.report;
+    replicaMessages[index] = simulation.messages;
+    if (simulation.checkpointFailed || simulation.verifyFailed) replicaFailed[index] = 1;
+}
+
+
+void ReplicaRunner::summarise()
+{
+    summaries.clear();
+    if (reports.empty()) return;
+
+    long long n = (long long)reports.size();
+    double t = SteadyStateDetector::tQuantile95((int)(n - 1));
+
+    // every replica ran the same configuration, so algorithms and metrics
+    // come in the same order in each report
+    const SimulationReport &first = reports[0];
+    for (size_t a = 0; a < first.algorithms.size(); a++)
+    {
+        AlgorithmSummary algorithm;
+        algorithm.name = first.algorithms[a].name;
+        algorithm.shortName = first.algorithms[a].shortName;
+
+        for (size_t m = 0; m < first.algorithms[a].metrics.size(); m++)
+        {
+            MetricSummary metric;
+            metric.key = first.algorithms[a].metrics[m].key;
+            metric.label = first.algorithms[a].metrics[m].label;
+
+            double sum = 0;
+            for (long long r = 0; r < n; r++) sum += (double)reports[r].algorithms[a].metrics[m].value;
+            metric.mean = sum / n;
+
+            if (n >= 2)
+            {
+                double squares = 0;
+                for (long long r = 0; r < n; r++)
+                {
+                    double difference = (double)reports[r].algorithms[a].metrics[m].value - metric.mean;
+                    squares += difference * difference;
+                }
+                metric.stdDev = sqrt(squares / (n - 1));
+                metric.halfWidth = t * metric.stdDev / sqrt((double)n);
+            }
+
+            algorithm.metrics.push_back(metric);
+        }
+
+        summaries.push_back(algorithm);
+    }
+}
+
+
+int ReplicaRunner::stopMetricNarrow()
+{
+    bool found = false;
+    bool narrow = true;
+
+    for (size_t a = 0; a < summaries.size(); a++)
+    {
+        for (size_t m = 0; m < summaries[a].metrics.size(); m++)
+        {
+            const MetricSummary &metric = summaries[a].metrics[m];
+            if (metric.key != stopMetric) continue;
+
+            found = true;
+            if (metric.halfWidth < 0 || metric.halfWidth > fabs(metric.mean) * targetHalfWidthPercent / 100.0) narrow = false;
+        }
+    }
+
+    if (!found) return -1;
+    return narrow ? 1 : 0;
+}
+
+
+string ReplicaRunner::formatNumber(double value)
+{
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), "%.4f", value);
+    return buffer;
+}
+
+
+string ReplicaRunner::toJson()
+{
+    string s;
+    s += "{\n";
+    s += "  \"testName\": \"" + SimulationReport::jsonEscape(baseConfig.testName) + "\",\n";
+
+    s += "  \"replicas\": {";
+    s += "\n    \"count\": " + to_string(reports.size()) + ",";
+    s += "\n    \"firstSeed\": " + to_string(baseConfig.seed) + ",";
+    s += "\n    \"threads\": " + to_string(threadCount);
+    if (targetHalfWidthPercent > 0)
+    {
+        s += ",\n    \"stopMetric\": \"" + SimulationReport::jsonEscape(stopMetric) + "\",";
+        s += "\n    \"targetHalfWidthPercent\": " + formatNumber(targetHalfWidthPercent) + ",";
+        s += "\n    \"stoppedEarly\": " + string(stoppedEarly ? "1" : "0");
+    }
+    s += "\n  },\n";
+
+    // config of the first replica, seed is the only thing that differs
+    s += "  \"config\": {";
+    bool firstValue = true;
+    if (!reports.empty())
+    {
+        for (size_t i = 0; i < reports[0].configValues.size(); i++)
+        {
+            if (reports[0].configValues[i].first == "seed") continue;
+            if (!firstValue) s += ",";
+            firstValue = false;
+            s += "\n    \"" + reports[0].configValues[i].first + "\": " + reports[0].configValues[i].second;
+        }
+    }
+    s += "\n  },\n";
+
+    s += "  \"algorithms\": [";
+    for (size_t a = 0; a < summaries.size(); a++)
+    {
+        const AlgorithmSummary &algorithm = summaries[a];
+
+        if (a) s += ",";
+        s += "\n    {\n";
+        s += "      \"name\": \"" + SimulationReport::jsonEscape(algorithm.name) + "\",\n";
+        s += "      \"shortName\": \"" + SimulationReport::jsonEscape(algorithm.shortName) + "\",\n";
+        s += "      \"metrics\": {";
+
+        for (size_t m = 0; m < algorithm.metrics.size(); m++)
+        {
+            const MetricSummary &metric = algorithm.metrics[m];
+
+            if (m) s += ",";
+            s += "\n        \"" + metric.key + "\": {\"mean\": " + formatNumber(metric.mean);
+            s += ", \"stdDev\": " + formatNumber(metric.stdDev);
+            if (metric.halfWidth < 0) s += ", \"ci95Low\": null, \"ci95High\": null}";
+            else
+            {
+                s += ", \"ci95Low\": " + formatNumber(metric.mean - metric.halfWidth);
+                s += ", \"ci95High\": " + formatNumber(metric.mean + metric.halfWidth) + "}";
+            }
+        }
+        s += "\n      }\n    }";
+    }
+    s += "\n  ]\n}\n";
+
+    return s;
+}
+
+
+string ReplicaRunner::toText()
+{
+    string s;
+
+    s += "Replicas: " + to_string(reports.size()) + " (seeds " + to_string(baseConfig.seed) + " to " + to_string(baseConfig.seed + (unsigned)reports.size() - 1) + ") on " + to_string(threadCount) + " threads";
+    if (targetHalfWidthPercent > 0) s += stoppedEarly ? ", stop target reached" : ", stop target not reached";
+    s += "\n\n";
+
+    if (summaries.empty()) return s;
+
+    s += "Replicated Comparison Table (mean +/- 95% half width)\n";
+    s += "Metric";
+    for (size_t a = 0; a < summaries.size(); a++) s += "," + summaries[a].shortName;
+    s += "\n";
+
+    size_t metricCount = summaries[0].metrics.size();
+    for (size_t m = 0; m < metricCount; m++)
+    {
+        s += summaries[0].metrics[m].label;
+        for (size_t a = 0; a < summaries.size(); a++)
+        {
+            s += ",";
+            if (m >= summaries[a].metrics.size()) continue;
+
+            const MetricSummary &metric = summaries[a].metrics[m];
+            s += formatNumber(metric.mean);
+            if (metric.halfWidth >= 0) s += " +/- " + formatNumber(metric.halfWidth);
+        }
+        s += "\n";
+    }
+    s += "\n";
+
+    return s;
+}
+
+
+bool ReplicaRunner::writeJson(const string &path)
+{
+    if (path.empty()) return false;
+
+    filesystem::path parent = filesystem::path(path).parent_path();
+    if (!parent.empty())
+    {
+        error_code ec;
+        filesystem::create_directories(parent, ec); //errors go into ec
+    }
+
+    string text = toJson(); //build whole file first, then write once
+    ofstream out(path, ios::binary);
+    if (!out) return false;
+
+    out.write(text.data(), (streamsize)text.size());
+    return (bool)out;
+}
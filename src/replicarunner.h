@@ -0,0 +1,77 @@
+#ifndef REPLICARUNNER_H
+#define REPLICARUNNER_H
+
+#include <string>
+#include <vector>
+#include "memorysimulation.h"
+#include "simulationreport.h"
+
+using namespace std;
+
+// --replicas, the same configuration run with seeds seed, seed+1, ... on a
+// pool of threads. each replica is its own MemorySimulation (own random
+// generator, allocators and writers) writing into replica_<n>/ beside the
+// normal output paths, so nothing is shared while they run. the final
+// metrics of every algorithm are summarised as mean, sample standard
+// deviation and a 95% student t interval
+class ReplicaRunner
+{
+public:
+    ReplicaRunner();
+
+    void configure(const SimulationConfig &baseConfig, int replicas, int threads);
+    void setStopping(double targetHalfWidthPercent, const string &metricKey, int maxReplicas); //sequential stopping, 0 = off
+
+    bool run(); //false if a replica failed or the stop metric is unknown
+
+    struct MetricSummary
+    {
+        string key;
+        string label;
+        double mean;
+        double stdDev; //sample, n - 1
+        double halfWidth; //95%, -1 with fewer than 2 replicas
+
+        MetricSummary()
+        {
+            mean = 0;
+            stdDev = 0;
+            halfWidth = -1;
+        }
+    };
+
+    struct AlgorithmSummary
+    {
+        string name;
+        string shortName;
+        vector<MetricSummary> metrics;
+    };
+
+    string toJson();
+    string toText(); //comparison table, mean +/- half width
+    bool writeJson(const string &path);
+
+    SimulationConfig baseConfig;
+    int replicaStep; //replicas per round, the first round too
+    int threadCount;
+    double targetHalfWidthPercent;
+    string stopMetric;
+    int maxReplicas;
+
+    vector<SimulationReport> reports; //one per replica, seed order
+    vector<AlgorithmSummary> summaries;
+    bool stoppedEarly;
+    bool failed;
+
+    void runRange(int first, int last); //replicas [first, last) on the pool
+    void runReplica(int index);
+    void summarise();
+    int stopMetricNarrow(); //1 yes, 0 no, -1 unknown metric
+
+    vector<char> replicaFailed; //written by one worker each
+    vector<string> replicaMessages; //warnings and verify result per replica, printed by run()
+
+    static string formatNumber(double value);
+};
+
+#endif // REPLICARUNNER_H
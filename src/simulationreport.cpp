@@ -0,0 +1,172 @@
+#include "simulationreport.h"
+#include <fstream>
+#include <filesystem>
+
+
+void AlgorithmReport::add(const string &key, const string &label, long long value)
+{
+    ReportMetric metric;
+    metric.key = key;
+    metric.label = label;
+    metric.value = value;
+    metrics.push_back(metric);
+}
+
+
+SimulationReport::SimulationReport(){}
+
+
+void SimulationReport::addConfig(const string &key, const string &value)
+{
+    configValues.push_back(make_pair(key, "\"" + jsonEscape(value) + "\""));
+}
+
+void SimulationReport::addConfig(const string &key, long long value)
+{
+    configValues.push_back(make_pair(key, to_string(value)));
+}
+
+
+void SimulationReport::addProfile(const string &key, const string &label, long long value)
+{
+    ReportMetric metric;
+    metric.key = key;
+    metric.label = label;
+    metric.value = value;
+    profile.push_back(metric);
+}
+
+
+string SimulationReport::jsonEscape(const string &text)
+{
+    string s;
+    for (size_t i = 0; i < text.size(); i++)
+    {
+        char c = text[i];
+
+        if (c == '"') s += "\\\"";
+        else if (c == '\\') s += "\\\\";
+        else if (c == '\n') s += "\\n";
+        else if ((unsigned char)c < 0x20) s += " "; //other control chars not expected
+        else s += c;
+    }
+    return s;
+}
+
+
+string SimulationReport::toJson()
+{
+    string s;
+    s += "{\n";
+    s += "  \"testName\": \"" + jsonEscape(testName) + "\",\n";
+
+    s += "  \"config\": {";
+    for (size_t i = 0; i < configValues.size(); i++)
+    {
+        if (i) s += ",";
+        s += "\n    \"" + configValues[i].first + "\": " + configValues[i].second;
+    }
+    s += "\n  },\n";
+
+    s += "  \"algorithms\": [";
+    for (size_t a = 0; a < algorithms.size(); a++)
+    {
+        const AlgorithmReport &algorithm = algorithms[a];
+
+        if (a) s += ",";
+        s += "\n    {\n";
+        s += "      \"name\": \"" + jsonEscape(algorithm.name) + "\",\n";
+        s += "      \"shortName\": \"" + jsonEscape(algorithm.shortName) + "\",\n";
+        s += "      \"metrics\": {";
+
+        for (size_t m = 0; m < algorithm.metrics.size(); m++)
+        {
+            if (m) s += ",";
+            s += "\n        \"" + algorithm.metrics[m].key + "\": " + to_string(algorithm.metrics[m].value);
+        }
+        s += "\n      }\n    }";
+    }
+    s += "\n  ]";
+
+    if (!profile.empty())
+    {
+        s += ",\n  \"profile\": {";
+        for (size_t i = 0; i < profile.size(); i++)
+        {
+            if (i) s += ",";
+            s += "\n    \"" + profile[i].key + "\": " + to_string(profile[i].value);
+        }
+        s += "\n  }";
+    }
+    s += "\n}\n";
+
+    return s;
+}
+
+
+string SimulationReport::toText()
+{
+    string s;
+
+    for (size_t a = 0; a < algorithms.size(); a++)
+    {
+        const AlgorithmReport &algorithm = algorithms[a];
+
+        s += "Final statistics for " + algorithm.name + ":\n";
+        for (size_t m = 0; m < algorithm.metrics.size(); m++)
+        {
+            s += algorithm.metrics[m].label + ": " + to_string(algorithm.metrics[m].value) + "\n";
+        }
+        s += "\n";
+    }
+
+    if (!profile.empty())
+    {
+        s += "Profile:\n";
+        for (size_t i = 0; i < profile.size(); i++) s += profile[i].label + ": " + to_string(profile[i].value) + "\n";
+        s += "\n";
+    }
+
+    if (algorithms.empty()) return s;
+
+    //TABLE, metrics line up since every algorithm adds them in same order
+    s += "Overall Comparison Table (per algorithm)\n";
+    s += "Metric";
+    for (size_t a = 0; a < algorithms.size(); a++) s += "," + algorithms[a].shortName;
+    s += "\n";
+
+    size_t metricCount = algorithms[0].metrics.size();
+    for (size_t m = 0; m < metricCount; m++)
+    {
+        s += algorithms[0].metrics[m].label;
+        for (size_t a = 0; a < algorithms.size(); a++)
+        {
+            s += ",";
+            if (m < algorithms[a].metrics.size()) s += to_string(algorithms[a].metrics[m].value);
+        }
+        s += "\n";
+    }
+    s += "\n";
+
+    return s;
+}
+
+
+bool SimulationReport::writeJson(const string &path)
+{
+    if (path.empty()) return false;
+
+    filesystem::path parent = filesystem::path(path).parent_path();
+    if (!parent.empty())
+    {
+        error_code ec;
+        filesystem::create_directories(parent, ec); //errors go into ec
+    }
+
+    string text = toJson(); //build whole file first, then write once
+    ofstream out(path, ios::binary);
+    if (!out) return false;
+
+    out.write(text.data(), (streamsize)text.size());
+    return (bool)out;
+}
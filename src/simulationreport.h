@@ -0,0 +1,54 @@
+#ifndef SIMULATIONREPORT_H
+#define SIMULATIONREPORT_H
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+struct ReportMetric //one named final statistic
+{
+    string key;   //json key, camelCase like summary.csv
+    string label; //text label
+    long long value;
+
+    ReportMetric()
+    {
+        value = 0;
+    }
+};
+
+
+struct AlgorithmReport //final statistics for one algorithm
+{
+    string name;      //"First Fit"
+    string shortName; //"FF"
+    vector<ReportMetric> metrics;
+
+    void add(const string &key, const string &label, long long value);
+};
+
+
+class SimulationReport
+{
+public:
+    SimulationReport();
+
+    void addConfig(const string &key, const string &value); //echo of inputs
+    void addConfig(const string &key, long long value);
+    void addProfile(const string &key, const string &label, long long value); //run wide --profile numbers
+
+    string toJson();
+    string toText(); // human readable view, per algorithm blocks + comparison table
+
+    bool writeJson(const string &path); //one buffered write
+
+    string testName;
+    vector<pair<string, string>> configValues; //already json encoded values
+    vector<AlgorithmReport> algorithms;
+    vector<ReportMetric> profile; //empty unless --profile
+
+    static string jsonEscape(const string &text);
+};
+
+#endif // SIMULATIONREPORT_H
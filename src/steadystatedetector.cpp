@@ -0,0 +1,216 @@
+#include "steadystatedetector.h"
+#include <cmath>
+
+
+SteadyStateDetector::SteadyStateDetector()
+{
+    windowSamples = 10;
+    tolerancePercent = 10;
+    halfWidthPercent = 5;
+    minBatches = 5;
+    steadyTime = -1;
+}
+
+
+void SteadyStateDetector::configure(int seriesCount, int windowSamplesValue, double tolerancePercentValue, double halfWidthPercentValue)
+{
+    series.assign(seriesCount, Series());
+    windowSamples = (windowSamplesValue > 1) ? windowSamplesValue : 2; //two halves
+    tolerancePercent = tolerancePercentValue;
+    halfWidthPercent = halfWidthPercentValue;
+    steadyTime = -1;
+}
+
+
+void SteadyStateDetector::addSample(int seriesIndex, double percentInUse, double percentFragmented)
+{
+    if (seriesIndex < 0 || seriesIndex >= (int)series.size()) return;
+    Series &s = series[seriesIndex];
+
+    if (steadyTime < 0) //still warming up, keep the window
+    {
+        s.recentInUse.push_back(percentInUse);
+        s.recentFragmented.push_back(percentFragmented);
+        if ((int)s.recentInUse.size() > windowSamples)
+        {
+            s.recentInUse.erase(s.recentInUse.begin());
+            s.recentFragmented.erase(s.recentFragmented.begin());
+        }
+        return;
+    }
+
+    s.batchSum += percentInUse;
+    s.batchFill++;
+    if (s.batchFill == windowSamples)
+    {
+        s.batchMeans.push_back(s.batchSum / windowSamples);
+        s.batchSum = 0;
+        s.batchFill = 0;
+    }
+}
+
+
+// means of the older and newer half of the window within tolerancePercent
+// of the whole window mean. single samples are far too noisy for a range
+// test, a drift between the halves is what warm up looks like. the mean
+// counts as at least 1 point so values near 0 dont need to be exact
+bool SteadyStateDetector::withinTolerance(const vector<double> &values, double tolerancePercent)
+{
+    size_t half = values.size() / 2;
+    if (half == 0) return false;
+
+    double olderSum = 0;
+    double newerSum = 0;
+    for (size_t i = 0; i < half; i++) olderSum += values[i];
+    for (size_t i = values.size() - half; i < values.size(); i++) newerSum += values[i];
+
+    double older = olderSum / half;
+    double newer = newerSum / half;
+
+    double reference = (older + newer) / 2;
+    if (reference < 1) reference = 1;
+
+    return fabs(newer - older) <= reference * tolerancePercent / 100.0;
+}
+
+
+void SteadyStateDetector::endSampleTime(int time)
+{
+    if (steadyTime >= 0 || series.empty()) return;
+
+    for (size_t i = 0; i < series.size(); i++)
+    {
+        if ((int)series[i].recentInUse.size() < windowSamples) return;
+        if (!withinTolerance(series[i].recentInUse, tolerancePercent)) return;
+        if (!withinTolerance(series[i].recentFragmented, tolerancePercent)) return;
+    }
+
+    steadyTime = time;
+}
+
+
+bool SteadyStateDetector::isSteady() {return steadyTime >= 0;}
+int SteadyStateDetector::getSteadyTime() {return steadyTime;}
+
+
+bool SteadyStateDetector::isConfident()
+{
+    if (steadyTime < 0 || series.empty()) return false;
+
+    for (size_t i = 0; i < series.size(); i++)
+    {
+        double halfWidth = getHalfWidth((int)i);
+        if (halfWidth < 0) return false;
+        if (halfWidth > getMean((int)i) * halfWidthPercent / 100.0) return false;
+    }
+
+    return true;
+}
+
+
+long long SteadyStateDetector::getBatchCount(int seriesIndex)
+{
+    if (seriesIndex < 0 || seriesIndex >= (int)series.size()) return 0;
+    return (long long)series[seriesIndex].batchMeans.size();
+}
+
+
+double SteadyStateDetector::getMean(int seriesIndex)
+{
+    if (getBatchCount(seriesIndex) == 0) return 0;
+
+    const vector<double> &means = series[seriesIndex].batchMeans;
+    double sum = 0;
+    for (size_t i = 0; i < means.size(); i++) sum += means[i];
+    return sum / means.size();
+}
+
+
+double SteadyStateDetector::getHalfWidth(int seriesIndex)
+{
+    long long n = getBatchCount(seriesIndex);
+    if (n < minBatches) return -1;
+
+    const vector<double> &means = series[seriesIndex].batchMeans;
+    double mean = getMean(seriesIndex);
+    double squares = 0;
+    for (size_t i = 0; i < means.size(); i++) squares += (means[i] - mean) * (means[i] - mean);
+
+    double deviation = sqrt(squares / (n - 1));
+    return tQuantile95((int)(n - 1)) * deviation / sqrt((double)n);
+}
+
+
+double SteadyStateDetector::tQuantile95(int degreesOfFreedom)
+{
+    static const double table[30] = {12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+                                     2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+                                     2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+
+    if (degreesOfFreedom < 1) return 0;
+    if (degreesOfFreedom <= 30) return table[degreesOfFreedom - 1];
+    if (degreesOfFreedom <= 60) return 2.000;
+    if (degreesOfFreedom <= 120) return 1.980;
+    return 1.960;
+}
+
+
+void SteadyStateDetector::saveState(BinaryWriter &out)
+{
+    out.writeInt(windowSamples);
+    out.writeDouble(tolerancePercent);
+    out.writeDouble(halfWidthPercent);
+    out.writeInt(minBatches);
+    out.writeInt(steadyTime);
+
+    out.writeInt((long long)series.size());
+    for (size_t i = 0; i < series.size(); i++)
+    {
+        const Series &s = series[i];
+
+        out.writeInt((long long)s.recentInUse.size());
+        for (size_t j = 0; j < s.recentInUse.size(); j++)
+        {
+            out.writeDouble(s.recentInUse[j]);
+            out.writeDouble(s.recentFragmented[j]);
+        }
+
+        out.writeDouble(s.batchSum);
+        out.writeInt(s.batchFill);
+        out.writeInt((long long)s.batchMeans.size());
+        for (size_t j = 0; j < s.batchMeans.size(); j++) out.writeDouble(s.batchMeans[j]);
+    }
+}
+
+
+bool SteadyStateDetector::loadState(BinaryReader &in)
+{
+    windowSamples = (int)in.readInt();
+    tolerancePercent = in.readDouble();
+    halfWidthPercent = in.readDouble();
+    minBatches = (int)in.readInt();
+    steadyTime = (int)in.readInt();
+
+    long long seriesCount = in.readInt();
+    if (!in.ok || seriesCount < 0 || seriesCount > 64) return false;
+
+    series.assign((size_t)seriesCount, Series());
+    for (size_t i = 0; i < series.size() && in.ok; i++)
+    {
+        Series &s = series[i];
+
+        long long recentCount = in.readInt();
+        for (long long j = 0; j < recentCount && in.ok; j++)
+        {
+            s.recentInUse.push_back(in.readDouble());
+            s.recentFragmented.push_back(in.readDouble());
+        }
+
+        s.batchSum = in.readDouble();
+        s.batchFill = (int)in.readInt();
+        long long batchCount = in.readInt();
+        for (long long j = 0; j < batchCount && in.ok; j++) s.batchMeans.push_back(in.readDouble());
+    }
+
+    return in.ok;
+}
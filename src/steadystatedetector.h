@@ -0,0 +1,63 @@
+#ifndef STEADYSTATEDETECTOR_H
+#define STEADYSTATEDETECTOR_H
+
+#include <vector>
+#include "binaryio.h"
+
+using namespace std;
+
+// --steadyState, decides when warm up is over and when enough has been
+// sampled. one series per algorithm: percent of memory in use and percent
+// of free memory outside the largest free block. steady once, for every
+// series, the means of the two halves of the last window samples differ by
+// at most tolerance percent of their mean. after that memory in use goes into batches of window samples and
+// the run is done once every series' batch means give a 95% confidence
+// interval no wider than +/- halfWidth percent of their mean
+class SteadyStateDetector
+{
+public:
+    SteadyStateDetector();
+
+    void configure(int seriesCount, int windowSamples, double tolerancePercent, double halfWidthPercent);
+    void addSample(int seriesIndex, double percentInUse, double percentFragmented); //once per series per sample time
+    void endSampleTime(int time); //after every series got its sample
+
+    bool isSteady();
+    int getSteadyTime(); //-1 until steady
+    bool isConfident(); //every series narrow enough
+
+    long long getBatchCount(int seriesIndex);
+    double getMean(int seriesIndex); //of the batch means
+    double getHalfWidth(int seriesIndex); //95%, -1 until minBatches batches
+
+    static double tQuantile95(int degreesOfFreedom); //two sided, student t
+
+    void saveState(BinaryWriter &out); //checkpoint
+    bool loadState(BinaryReader &in);
+
+    struct Series
+    {
+        vector<double> recentInUse; //last windowSamples, oldest first
+        vector<double> recentFragmented;
+        double batchSum; //memory in use, current batch
+        int batchFill;
+        vector<double> batchMeans;
+
+        Series()
+        {
+            batchSum = 0;
+            batchFill = 0;
+        }
+    };
+
+    vector<Series> series;
+    int windowSamples;
+    double tolerancePercent;
+    double halfWidthPercent;
+    int minBatches;
+    int steadyTime;
+
+    static bool withinTolerance(const vector<double> &values, double tolerancePercent);
+};
+
+#endif // STEADYSTATEDETECTOR_H
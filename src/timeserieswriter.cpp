@@ -0,0 +1,182 @@
+#include "timeserieswriter.h"
+#include "csvwriter.h"
+#include <filesystem>
+#include <iterator>
+
+
+static const char timeSeriesMagic[8] = {'M', 'S', 'I', 'M', 'T', 'S', '0', '1'};
+
+
+TimeSeriesWriter::TimeSeriesWriter()
+{
+    bufferLimit = 1 << 20;
+    recordCount = 0;
+    bytesWritten = 0;
+}
+
+
+TimeSeriesWriter::~TimeSeriesWriter()
+{
+    close();
+}
+
+
+bool TimeSeriesWriter::open(const string &path, const vector<string> &seriesNames)
+{
+    close();
+
+    filesystem::path parent = filesystem::path(path).parent_path();
+    if (!parent.empty())
+    {
+        error_code ec;
+        filesystem::create_directories(parent, ec); //errors go into ec
+    }
+
+    out.open(path, ios::binary);
+    if (!out) return false;
+
+    series.assign(seriesNames.size(), SeriesState());
+    recordCount = 0;
+    bytesWritten = 0;
+
+    buffer.assign(timeSeriesMagic, sizeof(timeSeriesMagic));
+    writeVarint(buffer, seriesNames.size());
+    for (size_t i = 0; i < seriesNames.size(); i++)
+    {
+        writeVarint(buffer, seriesNames[i].size());
+        buffer += seriesNames[i];
+    }
+
+    return true;
+}
+
+
+bool TimeSeriesWriter::isOpen()
+{
+    return out.is_open();
+}
+
+
+void TimeSeriesWriter::record(int seriesIndex, long long time, long long allocatedBytes, long long requiredBytes, long long freeBlocks, long long largestFreeBytes)
+{
+    if (seriesIndex < 0 || seriesIndex >= (int)series.size()) return;
+
+    SeriesState &last = series[seriesIndex];
+    long long values[5] = {time, allocatedBytes, requiredBytes, freeBlocks, largestFreeBytes};
+
+    if (last.written && values[1] == last.values[1] && values[2] == last.values[2] && values[3] == last.values[3] && values[4] == last.values[4]) return;
+
+    writeVarint(buffer, (unsigned long long)seriesIndex);
+    writeVarint(buffer, (unsigned long long)(values[0] - last.values[0])); //time only moves forward
+    for (int i = 1; i < 5; i++) writeVarint(buffer, zigzag(values[i] - last.values[i]));
+
+    for (int i = 0; i < 5; i++) last.values[i] = values[i];
+    last.written = true;
+    recordCount++;
+
+    if (buffer.size() >= bufferLimit) flush();
+}
+
+
+void TimeSeriesWriter::flush()
+{
+    if (buffer.empty() || !out.is_open()) return;
+
+    out.write(buffer.data(), (streamsize)buffer.size());
+    bytesWritten += (long long)buffer.size();
+    buffer.clear();
+}
+
+
+void TimeSeriesWriter::close()
+{
+    if (!out.is_open()) return;
+
+    flush();
+    out.close();
+}
+
+
+// 7 bits a byte, low first, high bit set while more follow
+void TimeSeriesWriter::writeVarint(string &target, unsigned long long value)
+{
+    while (value >= 0x80)
+    {
+        target += (char)((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    target += (char)value;
+}
+
+
+bool TimeSeriesWriter::readVarint(const string &source, size_t &position, unsigned long long &value)
+{
+    value = 0;
+    for (int shift = 0; shift < 64 && position < source.size(); shift += 7)
+    {
+        unsigned char byte = (unsigned char)source[position++];
+        value |= (unsigned long long)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false; //cut short or too long
+}
+
+
+// small changes either way stay small: 0,-1,1,-2 -> 0,1,2,3
+unsigned long long TimeSeriesWriter::zigzag(long long value)
+{
+    return ((unsigned long long)value << 1) ^ (unsigned long long)(value >> 63);
+}
+
+long long TimeSeriesWriter::unzigzag(unsigned long long value)
+{
+    return (long long)(value >> 1) ^ -(long long)(value & 1);
+}
+
+
+bool TimeSeriesWriter::decodeToCsv(const string &inPath, const string &outPath)
+{
+    ifstream in(inPath, ios::binary);
+    if (!in) return false;
+    string data((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+
+    if (data.size() < sizeof(timeSeriesMagic) || data.compare(0, sizeof(timeSeriesMagic), string(timeSeriesMagic, sizeof(timeSeriesMagic))) != 0) return false;
+    size_t position = sizeof(timeSeriesMagic);
+
+    unsigned long long seriesCount = 0;
+    if (!readVarint(data, position, seriesCount) || seriesCount > 64) return false;
+
+    vector<string> names;
+    for (unsigned long long i = 0; i < seriesCount; i++)
+    {
+        unsigned long long length = 0;
+        if (!readVarint(data, position, length) || length > data.size() - position) return false;
+        names.push_back(data.substr(position, (size_t)length));
+        position += (size_t)length;
+    }
+
+    CsvWriter writer(outPath);
+    writer.header({"time", "algorithm", "allocatedBytes", "requiredBytes", "freeBlocks", "largestFreeBlockBytes"});
+
+    vector<SeriesState> last(names.size());
+    while (position < data.size())
+    {
+        unsigned long long seriesIndex = 0;
+        unsigned long long fields[5];
+        if (!readVarint(data, position, seriesIndex) || seriesIndex >= names.size()) return false;
+        for (int i = 0; i < 5; i++) if (!readVarint(data, position, fields[i])) return false;
+
+        SeriesState &state = last[(size_t)seriesIndex];
+        state.values[0] += (long long)fields[0];
+        for (int i = 1; i < 5; i++) state.values[i] += unzigzag(fields[i]);
+
+        vector<string> row;
+        row.push_back(to_string(state.values[0]));
+        row.push_back(names[(size_t)seriesIndex]);
+        for (int i = 1; i < 5; i++) row.push_back(to_string(state.values[i]));
+        writer.row(row);
+    }
+
+    writer.close();
+    return true;
+}
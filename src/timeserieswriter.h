@@ -0,0 +1,57 @@
+#ifndef TIMESERIESWRITER_H
+#define TIMESERIESWRITER_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+
+using namespace std;
+
+// --timeSeries, memory metrics of every series (algorithm) after every
+// event that changed them. binary, "MSIMTS01", the series count and names,
+// then one record per change: series index, then the ticks since and the
+// change of allocated bytes, required bytes, free blocks and largest free
+// block against that series' last record. all unsigned LEB128 varints, the
+// changes zigzag encoded first, so an ordinary record is 6 to 10 bytes
+class TimeSeriesWriter
+{
+public:
+    TimeSeriesWriter();
+    ~TimeSeriesWriter();
+
+    bool open(const string &path, const vector<string> &seriesNames); //creates parent dir
+    bool isOpen();
+    void record(int series, long long time, long long allocatedBytes, long long requiredBytes, long long freeBlocks, long long largestFreeBytes); //skipped if nothing changed
+    void close();
+
+    static bool decodeToCsv(const string &inPath, const string &outPath); //one row per record, absolute values
+
+    struct SeriesState //last written record
+    {
+        long long values[5]; //time, allocated, required, free blocks, largest
+        bool written;
+
+        SeriesState()
+        {
+            for (int i = 0; i < 5; i++) values[i] = 0;
+            written = false;
+        }
+    };
+
+    ofstream out;
+    string buffer; //written out every bufferLimit bytes
+    size_t bufferLimit;
+    vector<SeriesState> series;
+
+    long long recordCount;
+    long long bytesWritten;
+
+    void flush();
+
+    static void writeVarint(string &target, unsigned long long value);
+    static bool readVarint(const string &source, size_t &position, unsigned long long &value);
+    static unsigned long long zigzag(long long value);
+    static long long unzigzag(unsigned long long value);
+};
+
+#endif // TIMESERIESWRITER_H
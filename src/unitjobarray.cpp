@@ -0,0 +1,155 @@
+#include "unitjobarray.h"
+#include <filesystem>
+#include <string.h>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+
+static const char unitMapMagic[8] = {'U', 'N', 'I', 'T', 'M', 'A', 'P', '2'};
+static const long long unitMapHeaderBytes = 16;
+
+
+UnitJobArray::UnitJobArray()
+{
+    data = nullptr;
+    count = 0;
+    mappedBase = nullptr;
+    mappedBytes = 0;
+    fd = -1;
+}
+
+UnitJobArray::~UnitJobArray()
+{
+    release();
+}
+
+
+UnitJobArray::UnitJobArray(const UnitJobArray &other)
+{
+    data = nullptr;
+    count = 0;
+    mappedBase = nullptr;
+    mappedBytes = 0;
+    fd = -1;
+    *this = other;
+}
+
+UnitJobArray &UnitJobArray::operator=(const UnitJobArray &other)
+{
+    if (this == &other) return *this;
+
+    release();
+    storage.assign(other.data, other.data + other.count);
+    count = other.count;
+    data = storage.empty() ? nullptr : storage.data();
+    return *this;
+}
+
+
+void UnitJobArray::allocate(long long countValue)
+{
+    release();
+
+    storage.assign(countValue, 0); //0 = free
+    count = countValue;
+    data = storage.empty() ? nullptr : storage.data();
+}
+
+
+#ifdef __linux__
+
+bool UnitJobArray::mapFile(const string &path, long long countValue, bool sequentialAccess)
+{
+    release();
+
+    filesystem::path parent = filesystem::path(path).parent_path();
+    if (!parent.empty())
+    {
+        error_code ec;
+        filesystem::create_directories(parent, ec);
+    }
+
+    int fileFd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fileFd < 0) return false;
+
+    long long bytes = unitMapHeaderBytes + countValue * (long long)sizeof(int);
+
+    // truncating to 0 first drops old contents, growing again leaves a sparse
+    // file of zeros, which already reads as all free
+    if (ftruncate(fileFd, 0) != 0)
+    {
+        ::close(fileFd);
+        return false;
+    }
+
+    if (ftruncate(fileFd, bytes) != 0)
+    {
+        ::close(fileFd);
+        return false;
+    }
+
+    // no swap reservation, pages come from the file on demand
+    void *base = mmap(nullptr, (size_t)bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_NORESERVE, fileFd, 0);
+    if (base == MAP_FAILED)
+    {
+        ::close(fileFd);
+        return false;
+    }
+
+    madvise(base, (size_t)bytes, sequentialAccess ? MADV_SEQUENTIAL : MADV_RANDOM); //scanners walk in order
+
+    mappedBase = base;
+    mappedBytes = bytes;
+    fd = fileFd;
+    filePath = path;
+    count = countValue;
+    data = (int *)((char *)base + unitMapHeaderBytes);
+
+    // only the header page gets dirtied, unit pages stay unbacked until used
+    memcpy(base, unitMapMagic, 8);
+    memcpy((char *)base + 8, &countValue, sizeof(countValue));
+
+    return true;
+}
+
+
+void UnitJobArray::sync()
+{
+    if (mappedBase) msync(mappedBase, (size_t)mappedBytes, MS_SYNC);
+}
+
+
+void UnitJobArray::release()
+{
+    if (mappedBase)
+    {
+        munmap(mappedBase, (size_t)mappedBytes); //shared mapping, contents stay in the file
+        ::close(fd);
+    }
+
+    mappedBase = nullptr;
+    mappedBytes = 0;
+    fd = -1;
+
+    vector<int>().swap(storage);
+    data = nullptr;
+    count = 0;
+}
+
+#else
+
+bool UnitJobArray::mapFile(const string &, long long, bool) {return false;} //no mmap here, caller falls back
+void UnitJobArray::sync() {}
+
+void UnitJobArray::release()
+{
+    vector<int>().swap(storage);
+    data = nullptr;
+    count = 0;
+}
+
+#endif
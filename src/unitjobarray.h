@@ -0,0 +1,51 @@
+#ifndef UNITJOBARRAY_H
+#define UNITJOBARRAY_H
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// owner id per memory unit (-1 = free), in memory or mapped from a file
+// a mapped file can be larger than RAM, the OS pages the hot parts in and out
+// file layout: 8 byte magic "UNITMAP2", 8 byte unit count, then one int per unit
+// holding id + 1, so 0 is free and a fresh sparse file needs no writes
+class UnitJobArray
+{
+public:
+    UnitJobArray();
+    ~UnitJobArray();
+
+    UnitJobArray(const UnitJobArray &other); //copies are always in memory
+    UnitJobArray &operator=(const UnitJobArray &other);
+
+    void allocate(long long countValue); //in memory, all free
+    bool mapFile(const string &path, long long countValue, bool sequentialAccess); //new file, all free
+    void release(); //drop the memory or mapping, a mapped file stays on disk
+    void sync(); //flush a mapping to its file
+
+    // reads and writes job ids, the +1 stays in here
+    struct Reference
+    {
+        int *slot;
+
+        operator int() const {return *slot - 1;}
+        Reference &operator=(int jobId) {*slot = jobId + 1; return *this;}
+        Reference &operator=(const Reference &other) {*slot = *other.slot; return *this;}
+    };
+
+    Reference operator[](long long i) {return Reference{data + i};}
+    long long size() const {return count;}
+    bool isMapped() const {return mappedBase != nullptr;}
+
+    int *data; //id + 1 per unit
+    long long count;
+    vector<int> storage; //in memory mode
+
+    void *mappedBase; //file mode
+    long long mappedBytes;
+    int fd;
+    string filePath;
+};
+
+#endif // UNITJOBARRAY_H